@@ -103,6 +103,23 @@ struct rpmi_message_header {
 	rpmi_uint16_t	token;
 };
 
+/** Notification event header: [15:0] EVENT_DATALEN and [23:16] EVENT_ID */
+#define RPMI_NOTIF_EVENT_DATALEN_POS		0
+#define RPMI_NOTIF_EVENT_DATALEN_MASK		0xffff
+#define RPMI_NOTIF_EVENT_ID_POS			16
+#define RPMI_NOTIF_EVENT_ID_MASK		0xff
+
+#define RPMI_NOTIF_EVENT_HDR(__id, __datalen)	\
+((((__id) & RPMI_NOTIF_EVENT_ID_MASK) << RPMI_NOTIF_EVENT_ID_POS) | \
+	(((__datalen) & RPMI_NOTIF_EVENT_DATALEN_MASK) << RPMI_NOTIF_EVENT_DATALEN_POS))
+
+/** REQUEST_STATE of the ENABLE_NOTIFICATION service */
+enum rpmi_notification_state {
+	RPMI_NOTIF_STATE_DISABLE	= 0x0,
+	RPMI_NOTIF_STATE_ENABLE		= 0x1,
+	RPMI_NOTIF_STATE_RETURN		= 0x2,
+};
+
 /** RPMI Message */
 struct rpmi_message {
 	struct rpmi_message_header	header;
@@ -182,6 +199,15 @@ enum rpmi_privilege_level {
 #define RPMI_PRIVILEGE_S_MODE_MASK	(1U << RPMI_PRIVILEGE_S_MODE)
 #define RPMI_PRIVILEGE_M_MODE_MASK	(1U << RPMI_PRIVILEGE_M_MODE)
 
+/**
+ * Priorities of RPMI service groups. Requests to high priority service groups
+ * are processed before other requests found in the same batch.
+ */
+enum rpmi_servicegroup_priority {
+	RPMI_SRVGRP_PRIORITY_NORMAL = 0,
+	RPMI_SRVGRP_PRIORITY_HIGH = 1,
+};
+
 /** RPMI ServiceGroups IDs */
 enum rpmi_servicegroup_id {
 	RPMI_SRVGRP_ID_MIN		= 0,
@@ -295,6 +321,9 @@ enum rpmi_hsm_service_id {
 	RPMI_HSM_SRV_HART_START			= 0x06,
 	RPMI_HSM_SRV_HART_STOP			= 0x07,
 	RPMI_HSM_SRV_HART_SUSPEND		= 0x08,
+	/* Implementation defined services */
+	RPMI_HSM_SRV_IMPL_HART_START_MASK	= 0x80,
+	RPMI_HSM_SRV_IMPL_HART_SUSPEND_MASK	= 0x81,
 	RPMI_HSM_SRV_ID_MAX
 };
 
@@ -348,6 +377,17 @@ enum rpmi_perf_service_id {
 	RPMI_PERF_SRV_ID_MAX,
 };
 
+/** RPMI Performance (PERF) ServiceGroup notification event IDs */
+enum rpmi_perf_notification_event_ids {
+	/* performance power change */
+	RPMI_PERF_POWER_CHANGE = 1,
+	/* performance limit change */
+	RPMI_PERF_LIMIT_CHANGE = 2,
+	/* performance level change */
+	RPMI_PERF_LEVEL_CHANGE = 3,
+	RPMI_PERF_EVENT_MAX_IDX,
+};
+
 /** RPMI Voltage (Volt) ServiceGroup Service IDs */
 enum rpmi_volt_service_id {
 	RPMI_VOLT_SRV_ENABLE_NOTIFICATION	= 0x01,
@@ -388,6 +428,21 @@ enum rpmi_mm_service_id {
 #define LIBRPMI_TRANSPORT_SHMEM_QUEUE_MIN_SIZE(__slot_size)	\
 	((__slot_size) * LIBRPMI_TRANSPORT_SHMEM_QUEUE_MIN_SLOTS)
 
+/**
+ * Shared memory transport flag: each queue has a single producer and a
+ * single consumer so the transport lock is not used and head/tail
+ * publication is ordered using acquire/release barriers only.
+ */
+#define LIBRPMI_TRANSPORT_SHMEM_FLAG_SPSC		(1U << 0)
+
+/**
+ * Shared memory transport flag: use a non-standard queue layout where the
+ * number of data slots is rounded down to a power of two and head/tail are
+ * free-running indices wrapped using a mask. The application processor side
+ * MUST use the same layout.
+ */
+#define LIBRPMI_TRANSPORT_SHMEM_FLAG_POW2		(1U << 1)
+
 /** RPMI shared memory structure to access a platform shared memory */
 struct rpmi_shmem;
 
@@ -436,6 +491,21 @@ rpmi_uint64_t rpmi_shmem_base(struct rpmi_shmem *shmem);
  */
 rpmi_uint32_t rpmi_shmem_size(struct rpmi_shmem *shmem);
 
+/**
+ * @brief Get a direct pointer to a part of shared memory
+ *
+ * The direct pointer is available only when the shared memory is directly
+ * addressable by the platform firmware, which is the case for shared memory
+ * created with rpmi_shmem_simple_ops.
+ *
+ * @param[in] shmem		pointer to shared memory instance
+ * @param[in] offset		offset within shared memory
+ * @param[in] len		number of bytes to be accessed
+ * @return pointer to shared memory upon success and NULL upon failure
+ */
+void *rpmi_shmem_direct_ptr(struct rpmi_shmem *shmem, rpmi_uint32_t offset,
+			    rpmi_uint32_t len);
+
 /**
  * @brief Read a buffer from shared memory
  *
@@ -507,6 +577,30 @@ void rpmi_shmem_destroy(struct rpmi_shmem *shmem);
  * @{
  */
 
+/** Occupancy and backpressure statistics of a RPMI transport queue */
+struct rpmi_transport_queue_stats {
+	/** Number of message slots in the queue */
+	rpmi_uint32_t capacity;
+
+	/** Number of pending messages last observed in the queue */
+	rpmi_uint32_t depth;
+
+	/** Maximum number of pending messages observed in the queue */
+	rpmi_uint32_t high_water_mark;
+
+	/** Number of enqueue attempts rejected because the queue was full */
+	rpmi_uint64_t full_count;
+
+	/** Number of dequeue attempts which found the queue empty */
+	rpmi_uint64_t empty_count;
+
+	/** Number of messages enqueued to the queue */
+	rpmi_uint64_t enqueue_count;
+
+	/** Number of messages dequeued from the queue */
+	rpmi_uint64_t dequeue_count;
+};
+
 /**
  * RPMI transport instance
  *
@@ -517,7 +611,10 @@ struct rpmi_transport {
 	/** Name of the transport */
 	const char	*name;
 
-	/** Endianness of the messages transferred through this transport */
+	/**
+	 * Endianness of the messages transferred through this transport
+	 * (must be false with LIBRPMI_LE_ONLY)
+	 */
 	rpmi_bool_t	is_be;
 
 	/**
@@ -529,6 +626,12 @@ struct rpmi_transport {
 	/** Slot (or max message) size in transport queues */
 	rpmi_size_t	slot_size;
 
+	/**
+	 * Is each queue used by a single producer and a single consumer
+	 * (transport lock is not used in this case)
+	 */
+	rpmi_bool_t	is_spsc;
+
 	/**
 	 * Callback to check if a RPMI queue type is empty
 	 *
@@ -546,7 +649,8 @@ struct rpmi_transport {
 				   enum rpmi_queue_type qtype);
 
 	/**
-	 * Callback to enqueue a RPMI message to a specified RPMI queue type
+	 * Callback to enqueue a RPMI message to a specified RPMI queue type.
+	 * Returns RPMI_ERR_IO if the queue is full.
 	 *
 	 * Note: This function must be called with transport lock held.
 	 */
@@ -555,7 +659,8 @@ struct rpmi_transport {
 				   const struct rpmi_message *msg);
 
 	/**
-	 * Callback to dequeue a RPMI message from a specified RPMI queue type
+	 * Callback to dequeue a RPMI message from a specified RPMI queue type.
+	 * Returns RPMI_ERR_IO if the queue is empty.
 	 *
 	 * Note: This function must be called with transport lock held.
 	 */
@@ -563,7 +668,69 @@ struct rpmi_transport {
 				   enum rpmi_queue_type qtype,
 				   struct rpmi_message *out_msg);
 
-	/** Lock to synchronize transport access (optional) */
+	/**
+	 * Callback to enqueue a batch of RPMI messages to a specified RPMI
+	 * queue type (optional). The messages are placed back-to-back with
+	 * a stride of slot_size bytes. Returns the number of messages enqueued
+	 * which can be less than count if the queue becomes full.
+	 *
+	 * Note: This function must be called with transport lock held.
+	 */
+	rpmi_uint32_t	(*enqueue_batch)(struct rpmi_transport *trans,
+					 enum rpmi_queue_type qtype,
+					 const struct rpmi_message *msgs,
+					 rpmi_uint32_t count);
+
+	/**
+	 * Callback to dequeue a batch of RPMI messages from a specified RPMI
+	 * queue type (optional). The messages are placed back-to-back with
+	 * a stride of slot_size bytes. Returns the number of messages dequeued
+	 * which can be less than max_count if the queue becomes empty.
+	 *
+	 * Note: This function must be called with transport lock held.
+	 */
+	rpmi_uint32_t	(*dequeue_batch)(struct rpmi_transport *trans,
+					 enum rpmi_queue_type qtype,
+					 struct rpmi_message *out_msgs,
+					 rpmi_uint32_t max_count);
+
+	/**
+	 * Callback to get a pointer to a slot of a specified RPMI queue type
+	 * without copying it (optional). For A2P queues, it returns the
+	 * index-th pending message from the head whereas for P2A queues, it
+	 * returns the index-th free slot from the tail. The message header
+	 * in the slot is in transport endianness. Returns NULL if the slot
+	 * is not available.
+	 *
+	 * Note: This function must be called with transport lock held.
+	 */
+	struct rpmi_message *(*peek_slot)(struct rpmi_transport *trans,
+					  enum rpmi_queue_type qtype,
+					  rpmi_uint32_t index);
+
+	/**
+	 * Callback to commit slots of a specified RPMI queue type previously
+	 * obtained using peek_slot (optional). For A2P queues, it releases
+	 * count messages from the head whereas for P2A queues, it publishes
+	 * count messages at the tail.
+	 *
+	 * Note: This function must be called with transport lock held.
+	 */
+	enum rpmi_error	(*commit_slot)(struct rpmi_transport *trans,
+				       enum rpmi_queue_type qtype,
+				       rpmi_uint32_t count);
+
+	/**
+	 * Callback to get statistics of a specified RPMI queue type
+	 * (optional)
+	 *
+	 * Note: This function must be called with transport lock held.
+	 */
+	void		(*get_queue_stats)(struct rpmi_transport *trans,
+					   enum rpmi_queue_type qtype,
+					   struct rpmi_transport_queue_stats *stats);
+
+	/** Lock to synchronize transport access (optional, unused if is_spsc) */
 	void		*lock;
 
 	/** Private data of the transport implementation */
@@ -614,6 +781,127 @@ enum rpmi_error rpmi_transport_dequeue(struct rpmi_transport *trans,
 				       enum rpmi_queue_type qtype,
 				       struct rpmi_message *out_msg);
 
+/**
+ * @brief Get a RPMI message from a batch of RPMI messages of a RPMI transport
+ *
+ * @param[in] trans		pointer to RPMI transport instance
+ * @param[in] msgs		pointer to the batch of RPMI messages
+ * @param[in] index		index of the RPMI message in the batch
+ * @return pointer to the RPMI message
+ */
+static inline struct rpmi_message *rpmi_transport_batch_msg(struct rpmi_transport *trans,
+							    struct rpmi_message *msgs,
+							    rpmi_uint32_t index)
+{
+	return (struct rpmi_message *)((rpmi_uint8_t *)msgs + (index * trans->slot_size));
+}
+
+/**
+ * @brief Enqueue a batch of RPMI messages to a specified RPMI queue type of
+ * a RPMI transport
+ *
+ * The transport lock is taken only once for the whole batch.
+ *
+ * @param[in] trans		pointer to RPMI transport instance
+ * @param[in] qtype		type of the RPMI queue
+ * @param[in] msgs		pointer to back-to-back RPMI messages with a
+ *				stride of transport slot size
+ * @param[in] count		number of RPMI messages to enqueue
+ * @return number of RPMI messages enqueued
+ */
+rpmi_uint32_t rpmi_transport_enqueue_batch(struct rpmi_transport *trans,
+					   enum rpmi_queue_type qtype,
+					   struct rpmi_message *msgs,
+					   rpmi_uint32_t count);
+
+/**
+ * @brief Dequeue a batch of RPMI messages from a specified RPMI queue type of
+ * a RPMI transport
+ *
+ * The transport lock is taken only once for the whole batch.
+ *
+ * @param[in] trans		pointer to RPMI transport instance
+ * @param[in] qtype		type of the RPMI queue
+ * @param[out] out_msgs		pointer to space for back-to-back RPMI messages
+ *				with a stride of transport slot size
+ * @param[in] max_count		maximum number of RPMI messages to dequeue
+ * @return number of RPMI messages dequeued
+ */
+rpmi_uint32_t rpmi_transport_dequeue_batch(struct rpmi_transport *trans,
+					   enum rpmi_queue_type qtype,
+					   struct rpmi_message *out_msgs,
+					   rpmi_uint32_t max_count);
+
+/**
+ * @brief Check if a RPMI transport supports in-place (zero-copy) access
+ * of queue slots using rpmi_transport_peek_slot() and
+ * rpmi_transport_commit_slot()
+ *
+ * RPMI contexts process requests in-place on such transports. Platforms
+ * which don't trust the application processor to leave request slots
+ * alone until acknowledged should create the shared memory with platform
+ * operations without direct access so that requests are copied first.
+ *
+ * @param[in] trans		pointer to RPMI transport instance
+ * @return true if supported and false if not supported
+ */
+static inline rpmi_bool_t rpmi_transport_can_peek(struct rpmi_transport *trans)
+{
+	return (trans && trans->peek_slot && trans->commit_slot) ? true : false;
+}
+
+/**
+ * @brief Get a pointer to a slot of a specified RPMI queue type of a RPMI
+ * transport without copying it
+ *
+ * For A2P queues, the index-th pending message from the head is returned
+ * whereas for P2A queues, the index-th free slot from the tail is returned.
+ * The message header in the slot is in transport endianness. The returned
+ * slot remains valid until it is committed using rpmi_transport_commit_slot()
+ * so only the single consumer (A2P) or producer (P2A) of a queue can use it.
+ *
+ * @param[in] trans		pointer to RPMI transport instance
+ * @param[in] qtype		type of the RPMI queue
+ * @param[in] index		index of the slot relative to head (A2P) or tail (P2A)
+ * @return pointer to the slot upon success and NULL upon failure
+ */
+struct rpmi_message *rpmi_transport_peek_slot(struct rpmi_transport *trans,
+					      enum rpmi_queue_type qtype,
+					      rpmi_uint32_t index);
+
+/**
+ * @brief Commit slots of a specified RPMI queue type of a RPMI transport
+ * previously obtained using rpmi_transport_peek_slot()
+ *
+ * For A2P queues, count messages are released from the head whereas for
+ * P2A queues, count messages are published at the tail.
+ *
+ * @param[in] trans		pointer to RPMI transport instance
+ * @param[in] qtype		type of the RPMI queue
+ * @param[in] count		number of slots to commit
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_transport_commit_slot(struct rpmi_transport *trans,
+					   enum rpmi_queue_type qtype,
+					   rpmi_uint32_t count);
+
+/**
+ * @brief Get occupancy and backpressure statistics of a specified RPMI
+ * queue type of a RPMI transport
+ *
+ * The statistics are collected from the point of view of the transport
+ * user so depth and high-water mark can overestimate the real occupancy
+ * until the index owned by the peer is read again.
+ *
+ * @param[in] trans		pointer to RPMI transport instance
+ * @param[in] qtype		type of the RPMI queue
+ * @param[out] stats		pointer to the statistics to be filled
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_transport_get_queue_stats(struct rpmi_transport *trans,
+					enum rpmi_queue_type qtype,
+					struct rpmi_transport_queue_stats *stats);
+
 /**
  * @brief Create a shared memory transport instance
  *
@@ -622,13 +910,15 @@ enum rpmi_error rpmi_transport_dequeue(struct rpmi_transport *trans,
  * @param[in] a2p_req_queue_size	size of A2P request and P2A acknowledgement queues
  * @param[in] p2a_req_queue_size	size of P2A request and A2P acknowledgement queues
  * @param[in] shmem		pointer to a RPMI shared memory instance
+ * @param[in] flags		LIBRPMI_TRANSPORT_SHMEM_FLAG_xyz flags
  * @return pointer to RPMI transport upon success and NULL upon failure
  */
 struct rpmi_transport *rpmi_transport_shmem_create(const char *name,
 						   rpmi_uint32_t slot_size,
 						   rpmi_uint32_t a2p_req_queue_size,
 						   rpmi_uint32_t p2a_req_queue_size,
-						   struct rpmi_shmem *shmem);
+						   struct rpmi_shmem *shmem,
+						   rpmi_uint32_t flags);
 
 /**
  * @brief Destroy (or free) a shared memory transport instance
@@ -655,13 +945,250 @@ void rpmi_transport_shmem_destroy(struct rpmi_transport *trans);
  */
 struct rpmi_context;
 
+/** Statistics of a RPMI service in a RPMI context (needs LIBRPMI_STATS) */
+struct rpmi_service_stats {
+	/** Number of requests processed */
+	rpmi_uint64_t request_count;
+
+	/** Number of requests for which the service handler failed */
+	rpmi_uint64_t error_count;
+
+	/** Number of requests answered as not supported */
+	rpmi_uint64_t notsupp_count;
+
+	/*
+	 * Latencies are measured with rpmi_env_get_timestamp() and remain 0
+	 * unless the platform firmware provides a time source for it.
+	 */
+
+	/** Minimum handler latency (rpmi_env_get_timestamp() units) */
+	rpmi_uint64_t min_latency;
+
+	/** Maximum handler latency (rpmi_env_get_timestamp() units) */
+	rpmi_uint64_t max_latency;
+
+	/**
+	 * Total handler latency (rpmi_env_get_timestamp() units) where
+	 * average latency is total_latency / request_count
+	 */
+	rpmi_uint64_t total_latency;
+};
+
+/**
+ * @brief Get statistics of a RPMI service in a RPMI context
+ *
+ * Statistics of all service IDs not implemented by the service group
+ * (i.e. service_id >= max_service_id) are accumulated together and
+ * returned for any such service ID.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] servicegroup_id	ID of the service group
+ * @param[in] service_id	ID of the service
+ * @param[out] stats		pointer to the statistics to be filled
+ * @return enum rpmi_error (RPMI_ERR_NOTSUPP without LIBRPMI_STATS)
+ */
+enum rpmi_error rpmi_context_get_stats(struct rpmi_context *cntx,
+				       rpmi_uint16_t servicegroup_id,
+				       rpmi_uint8_t service_id,
+				       struct rpmi_service_stats *stats);
+
 /**
  * @brief Process requests from application processors for a RPMI context
  *
+ * All transports of the RPMI context are drained one after another.
+ *
+ * Note: Requests of a RPMI context must be processed by one thread at a
+ * time. This applies to all callers of this function,
+ * rpmi_context_process_a2p_request_budget(), rpmi_context_poll(),
+ * rpmi_context_process_signalled() and rpmi_context_run().
+ *
  * @param[in] cntx		pointer to the RPMI context
  */
 void rpmi_context_process_a2p_request(struct rpmi_context *cntx);
 
+/**
+ * @brief Process a bounded number of requests from application processors
+ * for a RPMI context
+ *
+ * Unlike rpmi_context_process_a2p_request(), this function returns after
+ * max_msgs requests are processed even if more requests are pending so
+ * that the caller can interleave other work with bounded latency. The
+ * budget is shared by all transports of the RPMI context.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] max_msgs		maximum number of requests to process
+ * @param[out] processed	number of requests processed (optional)
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_context_process_a2p_request_budget(struct rpmi_context *cntx,
+						       rpmi_uint32_t max_msgs,
+						       rpmi_uint32_t *processed);
+
+/**
+ * @brief Poll all transports of a RPMI context for requests from
+ * application processors
+ *
+ * Transports are visited round-robin and at most budget requests are
+ * processed from each transport so that a busy transport does not starve
+ * the others. The transport visited first rotates across calls.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] budget		maximum number of requests per transport
+ * @return total number of requests processed
+ */
+rpmi_uint32_t rpmi_context_poll(struct rpmi_context *cntx, rpmi_uint32_t budget);
+
+/**
+ * @brief Get the number of times processing of requests from application
+ * processors stopped because the P2A acknowledgement queue was full
+ *
+ * Acknowledgements which don't fit in the P2A acknowledgement queue wait in
+ * a bounded per-transport backlog and are pushed by later calls to
+ * rpmi_context_process_a2p_request() or rpmi_context_poll(). Requests are
+ * not consumed from a transport while its backlog is full.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @return number of stalls summed across all transports of the RPMI context
+ */
+rpmi_uint64_t rpmi_context_ack_stall_count(struct rpmi_context *cntx);
+
+/**
+ * @brief Enable or disable coalescing of posted requests in a RPMI context
+ *
+ * When enabled, a posted request is not executed if a later posted request
+ * of the same batch targets the same service and object (first
+ * coalesce_key_len bytes of request data, see struct rpmi_service). Any
+ * other request to the same service group in between prevents coalescing.
+ * Coalescing is disabled by default.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] enable		true to enable and false to disable
+ */
+void rpmi_context_set_coalescing(struct rpmi_context *cntx, rpmi_bool_t enable);
+
+/**
+ * @brief Get the number of posted requests superseded by later posted
+ * requests and therefore not executed
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @return number of superseded requests summed across all transports
+ */
+rpmi_uint64_t rpmi_context_superseded_count(struct rpmi_context *cntx);
+
+/**
+ * @brief Queue a notification event of a service group
+ *
+ * Events are dropped unless enabled by the application processor using
+ * the ENABLE_NOTIFICATION service of the service group. Events are enabled
+ * separately on each transport of the RPMI context and an event is queued
+ * for every transport which enabled it. Queued events of a service group
+ * are sent together as one notification message on the P2A request queue
+ * of each such transport, with a single P2A doorbell per transport for all
+ * notification messages sent at the same time. RPMI_ERR_BUSY is returned
+ * without queueing the event if it does not fit for any of the transports.
+ *
+ * Queued events are sent from rpmi_context_process_all_events() or
+ * rpmi_context_flush_notifications(). This function may be called from
+ * any thread, including from service handlers.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] servicegroup_id	ID of the service group raising the event
+ * @param[in] event_id		notification event ID
+ * @param[in] data		pointer to the event data words (native endianness)
+ * @param[in] num_words		number of event data words
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_context_queue_notification(struct rpmi_context *cntx,
+						rpmi_uint16_t servicegroup_id,
+						rpmi_uint8_t event_id,
+						const rpmi_uint32_t *data,
+						rpmi_uint32_t num_words);
+
+/**
+ * @brief Send notification events queued in a RPMI context
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ */
+void rpmi_context_flush_notifications(struct rpmi_context *cntx);
+
+/**
+ * @brief Defer the acknowledgement of the request being processed
+ *
+ * A service handler (or the platform operation called by it) which cannot
+ * finish quickly calls this function, starts the operation and returns.
+ * No acknowledgement is sent when the handler returns and the response
+ * is instead sent once rpmi_context_complete_request() is called with
+ * the returned token.
+ *
+ * Note: This function must only be called from a service handler of
+ * the RPMI context. The acknowledgement is built in a slot preallocated
+ * for the request transport so at most LIBRPMI_CONTEXT_MAX_DEFERRED
+ * requests can be deferred at a time.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[out] token		token identifying the deferred request
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_context_defer_request(struct rpmi_context *cntx,
+					   rpmi_uint32_t *token);
+
+/**
+ * @brief Complete a request deferred by rpmi_context_defer_request()
+ *
+ * The response data must be in the endianness of the transport on which
+ * the request was received, as is the case for data written by service
+ * handlers. The acknowledgement is sent from the next request processing
+ * call on the RPMI context. This function may be called from any thread.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] token		token returned by rpmi_context_defer_request()
+ * @param[in] data		pointer to the response data
+ * @param[in] datalen		length of the response data in bytes
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_context_complete_request(struct rpmi_context *cntx,
+					      rpmi_uint32_t token,
+					      const void *data,
+					      rpmi_uint16_t datalen);
+
+/**
+ * @brief Add a transport to a RPMI context
+ *
+ * All transports of a RPMI context share the same service groups. The slot
+ * size of an added transport must not be smaller than the slot size of the
+ * transport used to create the RPMI context.
+ *
+ * Acknowledgements and notifications sent on the added transport ring
+ * its own P2A doorbell system MSI instead of the P2A doorbell of the
+ * system MSI service group which belongs to the primary transport.
+ *
+ * Note: This function must not be called while requests are being
+ * processed on the RPMI context.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] trans		pointer to RPMI transport instance
+ * @param[in] p2a_msi_index	system MSI index of P2A doorbell of the transport
+ *				(Note: A value greater than number of system
+ *				MSIs means not supported)
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_context_add_transport(struct rpmi_context *cntx,
+					   struct rpmi_transport *trans,
+					   rpmi_uint32_t p2a_msi_index);
+
+/**
+ * @brief Remove a transport from a RPMI context
+ *
+ * Note: The transport used to create the RPMI context can't be removed.
+ * This function must not be called while requests are being processed on
+ * the RPMI context.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] trans		pointer to RPMI transport instance
+ */
+void rpmi_context_remove_transport(struct rpmi_context *cntx,
+				   struct rpmi_transport *trans);
+
 /**
  * @brief Process events of RPMI service group in a RPMI context
  *
@@ -674,13 +1201,110 @@ void rpmi_context_process_group_events(struct rpmi_context *cntx,
 /**
  * @brief Process events of all RPMI service groups in a RPMI context
  *
+ * Only service groups marked pending using rpmi_context_mark_group_pending()
+ * are processed except for every Nth call (see
+ * rpmi_context_set_event_sweep_period()) which processes all service groups.
+ * Service groups returning RPMI_ERR_BUSY remain pending.
+ *
  * @param[in] cntx		pointer to the RPMI context
  */
 void rpmi_context_process_all_events(struct rpmi_context *cntx);
 
+/**
+ * @brief Mark events of a RPMI service group in a RPMI context as pending
+ *
+ * The service group is processed by the next rpmi_context_process_all_events()
+ * and rpmi_context_run() is woken up with LIBRPMI_CONTEXT_SIGNAL_EVENTS.
+ *
+ * Note: This function can be called from interrupt context for standard
+ * service groups.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] servicegroup_id	ID of the service group
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_context_mark_group_pending(struct rpmi_context *cntx,
+						rpmi_uint16_t servicegroup_id);
+
+/**
+ * @brief Set the period of sweeping events of all RPMI service groups
+ *
+ * Every period-th call of rpmi_context_process_all_events() processes all
+ * service groups including the ones not marked pending which is required
+ * for service groups that can only poll (e.g. CPPC fast-channels and
+ * suspended harts whose wakeup is not notified by the platform). A
+ * period of zero disables the sweep. The default period is
+ * LIBRPMI_CONTEXT_EVENT_SWEEP_PERIOD (8 unless overridden at build time).
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] period		number of calls between sweeps (0 to disable)
+ */
+void rpmi_context_set_event_sweep_period(struct rpmi_context *cntx,
+					 rpmi_uint32_t period);
+
+/** Signal source: A2P doorbell (requests pending on the transports) */
+#define LIBRPMI_CONTEXT_SIGNAL_A2P		(1U << 0)
+
+/** Signal source: event of a RPMI service group (e.g. system MSI inject) */
+#define LIBRPMI_CONTEXT_SIGNAL_EVENTS		(1U << 1)
+
+/** Signal source: stop the rpmi_context_run() loop */
+#define LIBRPMI_CONTEXT_SIGNAL_STOP		(1U << 2)
+
+/**
+ * @brief Signal sources of work to a RPMI context
+ *
+ * Marks the sources (LIBRPMI_CONTEXT_SIGNAL_xyz) as pending and wakes up
+ * rpmi_context_run(). The platform firmware calls this from its A2P doorbell
+ * interrupt handler or when a service group event source fires.
+ *
+ * Note: This function can be called from interrupt context.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @param[in] sources		bitmap of LIBRPMI_CONTEXT_SIGNAL_xyz
+ */
+void rpmi_context_signal(struct rpmi_context *cntx, rpmi_uint32_t sources);
+
+/**
+ * @brief Process the sources signalled to a RPMI context once
+ *
+ * Processes only the sources signalled with rpmi_context_signal(). Sources
+ * with work left afterwards (e.g. requests held back by a full P2A queue
+ * or service groups returning RPMI_ERR_BUSY) are signalled again because
+ * the application processor doesn't signal when it drains a queue.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ * @return bitmap of LIBRPMI_CONTEXT_SIGNAL_xyz with work left including
+ * LIBRPMI_CONTEXT_SIGNAL_STOP if it was signalled
+ */
+rpmi_uint32_t rpmi_context_process_signalled(struct rpmi_context *cntx);
+
+/**
+ * @brief Run a RPMI context until it is stopped
+ *
+ * Sleeps using rpmi_env_wait_event() until sources are signalled with
+ * rpmi_context_signal() and then processes them using
+ * rpmi_context_process_signalled(). When work is left or the event sweep
+ * is enabled, rpmi_env_wait_event_timeout() is used instead so that work
+ * left is retried and service groups which can only poll are swept. Returns
+ * after LIBRPMI_CONTEXT_SIGNAL_STOP is signalled and the other sources
+ * signalled with it are processed.
+ *
+ * Note: If rpmi_env_alloc_event() is not supported then all sources are
+ * polled in a busy loop.
+ *
+ * @param[in] cntx		pointer to the RPMI context
+ */
+void rpmi_context_run(struct rpmi_context *cntx);
+
 /**
  * @brief Find a RPMI service group in a RPMI context
  *
+ * Standard service groups and the first LIBRPMI_CONTEXT_IMPL_DISPATCH_COUNT
+ * (16 unless overridden at build time) IDs of the experimental and vendor
+ * ranges are found using direct-indexed tables without taking the groups
+ * lock whereas other service groups are searched linearly.
+ *
  * @param[in] cntx		pointer to the RPMI context
  * @param[in] servicegroup_id	ID of the service group
  * @return pointer to RPMI service group upon success and NULL upon failure
@@ -701,6 +1325,16 @@ enum rpmi_error rpmi_context_add_group(struct rpmi_context *cntx,
 /**
  * @brief Remove a RPMI service group from a RPMI context
  *
+ * The dispatch table of the service group is retired instead of freed
+ * because lookups of standard service groups don't take the groups lock.
+ * Retired dispatch tables are freed by rpmi_context_destroy().
+ *
+ * Note: A request or event lookup racing with the removal can still call
+ * into the removed group so it must not be destroyed until the call of
+ * rpmi_context_process_a2p_request(), rpmi_context_poll(),
+ * rpmi_context_process_all_events() or rpmi_context_run() in progress
+ * on other threads has returned.
+ *
  * @param[in] cntx		pointer to the RPMI context
  * @param[in] group		pointer to the RPMI service group
  */
@@ -753,10 +1387,23 @@ struct rpmi_service {
 	/** Minimum data length for handling request */
 	rpmi_uint16_t	min_a2p_request_datalen;
 
+	/**
+	 * Number of leading request data bytes identifying the target object
+	 * of the service (e.g. domain ID) so that posted requests to the same
+	 * object can be coalesced (0 if the service can't be coalesced)
+	 */
+	rpmi_uint16_t	coalesce_key_len;
+
 	/**
 	 * Callback to process a2p request
 	 *
 	 * Note: This function must be called with service group lock held.
+	 *
+	 * Note: The request data is at most slot size minus the message
+	 * header but on transports supporting in-place access it is read
+	 * directly from shared memory which the application processor can
+	 * still modify, so each request field must be read exactly once and
+	 * the read value used for both validation and processing.
 	 */
 	enum rpmi_error	(*process_a2p_request)(struct rpmi_service_group *group,
 					       struct rpmi_service *service,
@@ -778,6 +1425,9 @@ struct rpmi_service_group {
 	/** Maximum service ID of the service group */
 	rpmi_uint8_t		max_service_id;
 
+	/** Priority of the service group (enum rpmi_servicegroup_priority) */
+	rpmi_uint8_t		priority;
+
 	/** Service group version */
 	rpmi_uint32_t		servicegroup_version;
 
@@ -792,6 +1442,14 @@ struct rpmi_service_group {
 	/** Array of services indexed by service ID */
 	struct rpmi_service	*services;
 
+	/**
+	 * Bitmap of notification event IDs (below 32) supported by the
+	 * service group. If the ENABLE_NOTIFICATION service (service ID 0x01)
+	 * has no request handler then it is implemented by the RPMI context
+	 * which tracks the subscriptions of these events.
+	 */
+	rpmi_uint32_t		notification_events;
+
 	/**
 	 * Callback to process events for a service group. These events can be:
 	 *
@@ -903,6 +1561,27 @@ struct rpmi_hsm_platform_ops {
 						 rpmi_uint32_t hart_index,
 						 const struct rpmi_hsm_suspend_type *suspend_type,
 						 rpmi_uint64_t resume_addr);
+
+	/**
+	 * Prepare a set of harts to start (optional). Bit N of the mask
+	 * selects hart index (hart_index_base + N). Used instead of
+	 * hart_start_prepare when starting multiple harts together.
+	 */
+	enum rpmi_error	(*hart_start_prepare_mask)(void *priv,
+						   rpmi_uint32_t hart_index_base,
+						   rpmi_uint64_t hart_index_mask,
+						   rpmi_uint64_t start_addr);
+
+	/**
+	 * Prepare a set of harts to suspend (optional). Bit N of the mask
+	 * selects hart index (hart_index_base + N). Used instead of
+	 * hart_suspend_prepare when suspending multiple harts together.
+	 */
+	enum rpmi_error	(*hart_suspend_prepare_mask)(void *priv,
+						rpmi_uint32_t hart_index_base,
+						rpmi_uint64_t hart_index_mask,
+						const struct rpmi_hsm_suspend_type *suspend_type,
+						rpmi_uint64_t resume_addr);
 };
 
 /**
@@ -923,6 +1602,18 @@ rpmi_uint32_t rpmi_hsm_hart_count(struct rpmi_hsm *hsm);
 rpmi_uint32_t rpmi_hsm_hart_index2id(struct rpmi_hsm *hsm,
 				     rpmi_uint32_t hart_index);
 
+/**
+ * @brief Get the array of hart IDs of HSM instance
+ *
+ * The array is indexed by hart index and has rpmi_hsm_hart_count()
+ * entries. For non-leaf HSM instance, it covers harts of all child
+ * HSM instances.
+ *
+ * @param[in] hsm		pointer to HSM instance
+ * @return pointer to the hart ID array upon success and NULL upon failure
+ */
+const rpmi_uint32_t *rpmi_hsm_hart_id_array(struct rpmi_hsm *hsm);
+
 /**
  * @brief Get hart index from hart ID for HSM instance
  *
@@ -975,6 +1666,26 @@ enum rpmi_error rpmi_hsm_hart_start(struct rpmi_hsm *hsm,
 				    rpmi_uint32_t hart_id,
 				    rpmi_uint64_t start_addr);
 
+/**
+ * @brief Start a set of harts in HSM instance
+ *
+ * Harts already started (or being started) are left as-is. The platform
+ * is asked to prepare all selected harts of a leaf HSM instance at once
+ * if it provides hart_start_prepare_mask.
+ *
+ * @param[in] hsm			pointer to HSM instance
+ * @param[in] hart_id_base		hart ID of bit 0 of the hart mask
+ * @param[in] hart_mask			bit N selects hart ID (hart_id_base + N)
+ * @param[in] start_addr		address where the harts will start executing
+ * @param[out] failed_mask		harts which were not started (optional)
+ * @return enum rpmi_error of the last hart which failed to start
+ */
+enum rpmi_error rpmi_hsm_hart_start_mask(struct rpmi_hsm *hsm,
+					 rpmi_uint32_t hart_id_base,
+					 rpmi_uint32_t hart_mask,
+					 rpmi_uint64_t start_addr,
+					 rpmi_uint32_t *failed_mask);
+
 /**
  * @brief Stop a hart
  *
@@ -1000,6 +1711,29 @@ enum rpmi_error rpmi_hsm_hart_suspend(struct rpmi_hsm *hsm,
 				      const struct rpmi_hsm_suspend_type *suspend_type,
 				      rpmi_uint64_t resume_addr);
 
+/**
+ * @brief Suspend a set of harts
+ *
+ * Harts already suspended (or being suspended) are left as-is. The
+ * platform is asked to prepare all selected harts of a leaf HSM instance
+ * at once if it provides hart_suspend_prepare_mask.
+ *
+ * @param[in] hsm			pointer to HSM instance
+ * @param[in] hart_id_base		hart ID of bit 0 of the hart mask
+ * @param[in] hart_mask			bit N selects hart ID (hart_id_base + N)
+ * @param[in] suspend_type		pointer to hart suspend type
+ * @param[in] resume_addr		address where the harts will resume executing
+ *					for non-retentive suspend
+ * @param[out] failed_mask		harts which were not suspended (optional)
+ * @return enum rpmi_error of the last hart which failed to suspend
+ */
+enum rpmi_error rpmi_hsm_hart_suspend_mask(struct rpmi_hsm *hsm,
+				rpmi_uint32_t hart_id_base,
+				rpmi_uint32_t hart_mask,
+				const struct rpmi_hsm_suspend_type *suspend_type,
+				rpmi_uint64_t resume_addr,
+				rpmi_uint32_t *failed_mask);
+
 /**
  * @brief Get the current HSM hart state
  *
@@ -1011,11 +1745,49 @@ enum rpmi_error rpmi_hsm_hart_suspend(struct rpmi_hsm *hsm,
 int rpmi_hsm_get_hart_state(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id);
 
 /**
- * @brief Synchronize state of each hart with HW state
+ * @brief Synchronize state of harts with HW state
+ *
+ * Only harts marked pending are checked. Harts are marked pending while
+ * they are in a *_PENDING or SUSPENDED state (unless wakeup notification
+ * is enabled using rpmi_hsm_set_wakeup_notify()) and by
+ * rpmi_hsm_notify_hw_state().
+ *
+ * @param[in] hsm		pointer to HSM instance
+ * @return true if any checked hart is still in a *_PENDING state and
+ * false otherwise (suspended harts waiting for wakeup are not counted)
+ */
+rpmi_bool_t rpmi_hsm_process_state_changes(struct rpmi_hsm *hsm);
+
+/**
+ * @brief Notify a HW state change of a hart
+ *
+ * The hart is checked by the next rpmi_hsm_process_state_changes(). This
+ * function only sets pending bits so it can be called from interrupt
+ * context. The HSM service group of the HSM instance is also marked
+ * pending in its RPMI context so the state change is processed by the
+ * next rpmi_context_process_all_events().
  *
  * @param[in] hsm		pointer to HSM instance
+ * @param[in] hart_index	index of the hart in HSM instance
+ * @return enum rpmi_error
  */
-void rpmi_hsm_process_state_changes(struct rpmi_hsm *hsm);
+enum rpmi_error rpmi_hsm_notify_hw_state(struct rpmi_hsm *hsm,
+					 rpmi_uint32_t hart_index);
+
+/**
+ * @brief Enable or disable wakeup notification of suspended harts
+ *
+ * By default, suspended harts stay marked pending so their HW state is
+ * polled by every rpmi_hsm_process_state_changes() until they wake up.
+ * Platforms which call rpmi_hsm_notify_hw_state() when a suspended hart
+ * wakes up enable this so that suspended harts are only checked upon
+ * notification. For a non-leaf instance, the setting is applied to all
+ * child instances. Wakeup notification is disabled by default.
+ *
+ * @param[in] hsm		pointer to HSM instance
+ * @param[in] enable		true to enable and false to disable
+ */
+void rpmi_hsm_set_wakeup_notify(struct rpmi_hsm *hsm, rpmi_bool_t enable);
 
 /**
  * @brief Create a leaf HSM instance to manage a set of harts
@@ -1038,6 +1810,10 @@ struct rpmi_hsm *rpmi_hsm_create(rpmi_uint32_t hart_count,
 /**
  * @brief Create a non-leaf HSM instance to manage a set of HSM instances
  *
+ * Hart IDs and hart indices of all child instances are flattened into
+ * lookup tables when the non-leaf instance is created, so the child
+ * instances must not be destroyed before the non-leaf instance.
+ *
  * @param[in] child_count		number of child HSM instances to manage
  * @param[in] child_array		array of child HSM instances
  * @return pointer to RPMI HSM instance upon success and NULL upon failure
@@ -1527,6 +2303,22 @@ rpmi_service_group_cppc_create(struct rpmi_hsm *hsm,
 			       const struct rpmi_cppc_platform_ops *ops,
 			       void *ops_priv);
 
+/**
+ * @brief Notify a write to the performance request fast-channel of a cppc
+ * service group instance
+ *
+ * The fast-channel has no doorbell so it is checked by the event sweep of
+ * the RPMI context (see rpmi_context_set_event_sweep_period()). Platforms
+ * which can detect fast-channel writes (e.g. using a write trap) call this
+ * to get the write processed by the next rpmi_context_process_all_events().
+ *
+ * Note: This function can be called from interrupt context.
+ *
+ * @param[in] group	pointer to RPMI service group instance
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_service_group_cppc_notify_fastchan(struct rpmi_service_group *group);
+
 /**
  * @brief Destroy (or free) a cppc service group instance
  *
@@ -1844,6 +2636,53 @@ rpmi_service_group_perf_create(rpmi_uint32_t perf_count,
 			       const struct rpmi_perf_fc_memory_region *fc_mem_region,
 			       void *ops_priv);
 
+/**
+ * @brief Notify a power change of a performance domain
+ *
+ * Queues a PERF_POWER_CHANGE notification event on the RPMI context of
+ * the service group. Level and limit changes requested by the application
+ * processor are notified by the service group itself whereas changes made
+ * by the platform (e.g. thermal throttling) are notified by the platform
+ * using rpmi_service_group_perf_notify_limit() and
+ * rpmi_service_group_perf_notify_level().
+ *
+ * Note: This function can be called from any thread.
+ *
+ * @param[in] group		pointer to RPMI service group instance
+ * @param[in] perf_id		performance domain ID
+ * @param[in] power_uw		new power consumption in microwatts
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_service_group_perf_notify_power(struct rpmi_service_group *group,
+						     rpmi_uint32_t perf_id,
+						     rpmi_uint32_t power_uw);
+
+/**
+ * @brief Notify a limit change of a performance domain made by the platform
+ *
+ * @param[in] group		pointer to RPMI service group instance
+ * @param[in] perf_id		performance domain ID
+ * @param[in] max_perf_limit	new maximum performance limit
+ * @param[in] min_perf_limit	new minimum performance limit
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_service_group_perf_notify_limit(struct rpmi_service_group *group,
+						     rpmi_uint32_t perf_id,
+						     rpmi_uint32_t max_perf_limit,
+						     rpmi_uint32_t min_perf_limit);
+
+/**
+ * @brief Notify a level change of a performance domain made by the platform
+ *
+ * @param[in] group		pointer to RPMI service group instance
+ * @param[in] perf_id		performance domain ID
+ * @param[in] perf_level	new performance level
+ * @return enum rpmi_error
+ */
+enum rpmi_error rpmi_service_group_perf_notify_level(struct rpmi_service_group *group,
+						     rpmi_uint32_t perf_id,
+						     rpmi_uint32_t perf_level);
+
 /**
  * @brief Destroy(free) a performance service group instance
  *
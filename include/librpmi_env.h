@@ -59,9 +59,28 @@ typedef long			rpmi_ssize_t;
  * @{
  */
 
+/** Word used by memory functions (may alias any other type) */
+typedef unsigned long __attribute__((__may_alias__)) rpmi_env_word_t;
+
+/** Check if pointers have the same offset within a word */
+#define RPMI_ENV_WORD_COALIGNED(p1, p2)		\
+	((((rpmi_uintptr_t)(p1) ^ (rpmi_uintptr_t)(p2)) &	\
+	  (sizeof(rpmi_env_word_t) - 1)) == 0)
+
+/** Check if a pointer is word aligned */
+#define RPMI_ENV_WORD_ALIGNED(p)			\
+	(((rpmi_uintptr_t)(p) & (sizeof(rpmi_env_word_t) - 1)) == 0)
+
+#if defined(LIBRPMI_ENV_RVV) && !defined(__riscv_vector)
+#error "LIBRPMI_ENV_RVV requires a compiler targeting the RISC-V V extension"
+#endif
+
 /**
  * @brief compare memory from one place to another
  *
+ * Note: Words are compared when both pointers are equally aligned and the
+ * first differing word is compared byte-at-a-time.
+ *
  * @param[in] s1	pointer to src1
  * @param[in] s2	pointer to src2
  * @param[in] n		number of bytes to compare
@@ -72,6 +91,23 @@ static inline int rpmi_env_memcmp(void *s1, void *s2, rpmi_size_t n)
 	char *temp1 = s1;
 	char *temp2 = s2;
 
+	if (RPMI_ENV_WORD_COALIGNED(temp1, temp2)) {
+		while (n > 0 && !RPMI_ENV_WORD_ALIGNED(temp1)) {
+			if (*temp1 != *temp2)
+				break;
+			temp1++;
+			temp2++;
+			n--;
+		}
+
+		while (n >= sizeof(rpmi_env_word_t) &&
+		       *(rpmi_env_word_t *)temp1 == *(rpmi_env_word_t *)temp2) {
+			temp1 += sizeof(rpmi_env_word_t);
+			temp2 += sizeof(rpmi_env_word_t);
+			n -= sizeof(rpmi_env_word_t);
+		}
+	}
+
 	while (n > 0) {
 		if (*temp1 < *temp2)
 			return -1;
@@ -88,6 +124,9 @@ static inline int rpmi_env_memcmp(void *s1, void *s2, rpmi_size_t n)
 /**
  * @brief Copy memory from one place to another
  *
+ * Note: Uses RISC-V vector instructions with LIBRPMI_ENV_RVV otherwise
+ * words are copied when both pointers are equally aligned.
+ *
  * @param[in] dest 	pointer to destination
  * @param[in] src 	pointer to destination
  * @param[in] n 	number of bytes to copy
@@ -97,11 +136,41 @@ static inline void *rpmi_env_memcpy(void *dest, const void *src, rpmi_size_t n)
 {
 	char *temp1 = dest;
 	const char *temp2 = src;
+#ifdef LIBRPMI_ENV_RVV
+	rpmi_size_t vl;
+
+	while (n > 0) {
+		__asm__ __volatile__("vsetvli %0, %1, e8, m8, ta, ma\n\t"
+				     "vle8.v v0, (%2)\n\t"
+				     "vse8.v v0, (%3)"
+				     : "=&r"(vl)
+				     : "r"(n), "r"(temp2), "r"(temp1)
+				     : "memory", "v0", "v1", "v2", "v3",
+				       "v4", "v5", "v6", "v7");
+		temp1 += vl;
+		temp2 += vl;
+		n -= vl;
+	}
+#else
+	if (RPMI_ENV_WORD_COALIGNED(temp1, temp2)) {
+		while (n > 0 && !RPMI_ENV_WORD_ALIGNED(temp1)) {
+			*temp1++ = *temp2++;
+			n--;
+		}
+
+		while (n >= sizeof(rpmi_env_word_t)) {
+			*(rpmi_env_word_t *)temp1 = *(const rpmi_env_word_t *)temp2;
+			temp1 += sizeof(rpmi_env_word_t);
+			temp2 += sizeof(rpmi_env_word_t);
+			n -= sizeof(rpmi_env_word_t);
+		}
+	}
 
 	while (n > 0) {
 		*temp1++ = *temp2++;
 		n--;
 	}
+#endif
 
 	return dest;
 }
@@ -109,6 +178,9 @@ static inline void *rpmi_env_memcpy(void *dest, const void *src, rpmi_size_t n)
 /**
  * @brief Write or fill a memory range with a character
  *
+ * Note: Uses RISC-V vector instructions with LIBRPMI_ENV_RVV otherwise
+ * aligned words are written.
+ *
  * @param[in] dest 	pointer to destination
  * @param[in] c 	character to write of fill
  * @param[in] n 	number of bytes to write
@@ -117,12 +189,42 @@ static inline void *rpmi_env_memcpy(void *dest, const void *src, rpmi_size_t n)
 static inline void *rpmi_env_memset(void *dest, int c, rpmi_size_t n)
 {
 	char *temp = dest;
+#ifdef LIBRPMI_ENV_RVV
+	rpmi_size_t vl;
 
 	while (n > 0) {
+		__asm__ __volatile__("vsetvli %0, %1, e8, m8, ta, ma\n\t"
+				     "vmv.v.x v0, %2\n\t"
+				     "vse8.v v0, (%3)"
+				     : "=&r"(vl)
+				     : "r"(n), "r"(c), "r"(temp)
+				     : "memory", "v0", "v1", "v2", "v3",
+				       "v4", "v5", "v6", "v7");
+		temp += vl;
+		n -= vl;
+	}
+#else
+	rpmi_env_word_t word;
+
+	while (n > 0 && !RPMI_ENV_WORD_ALIGNED(temp)) {
 		n--;
 		*temp++ = c;
 	}
 
+	/* Replicate the character to all bytes of a word */
+	word = (rpmi_env_word_t)-1 / 0xff * (unsigned char)c;
+	while (n >= sizeof(rpmi_env_word_t)) {
+		*(rpmi_env_word_t *)temp = word;
+		temp += sizeof(rpmi_env_word_t);
+		n -= sizeof(rpmi_env_word_t);
+	}
+
+	while (n > 0) {
+		n--;
+		*temp++ = c;
+	}
+#endif
+
 	return dest;
 }
 
@@ -286,6 +388,163 @@ static inline void rpmi_env_unlock(void *lptr)
 
 /******************************************************************************/
 
+/**
+ * \defgroup EVENT_ENV Event Environment Functions
+ * @brief Wait/notify functions used by library which can be provided by the
+ * platform firmware.
+ * @{
+ */
+
+/**
+ * @brief Dynamically allocate an event for wait/notify
+ *
+ * An event is signalled or not signalled. Waiting on a signalled event
+ * returns immediately and clears it so a signal is never lost.
+ *
+ * Note: If events are not supported then this function will always return
+ * NULL and users of events fall back to polling.
+ *
+ * @return void *	Pointer to the allocated event
+ */
+static inline void *rpmi_env_alloc_event(void)
+{
+	return NULL;
+}
+
+/**
+ * @brief Dynamically free an event
+ *
+ * Note: This function does nothing if event pointer is NULL.
+ *
+ * @param[in] eptr 	Pointer to event
+ */
+static inline void rpmi_env_free_event(void *eptr)
+{
+}
+
+/**
+ * @brief Wait (sleep) until an event is signalled and clear it
+ *
+ * Note: This function does nothing if event pointer is NULL.
+ *
+ * @param[in] eptr 	Pointer to event
+ */
+static inline void rpmi_env_wait_event(void *eptr)
+{
+	/* Do the actual waiting if available */
+}
+
+/**
+ * @brief Wait (sleep) until an event is signalled or a timeout expires and
+ * clear it
+ *
+ * Note: This function does nothing if event pointer is NULL.
+ *
+ * @param[in] eptr 	Pointer to event
+ * @param[in] timeout_us	Maximum time to wait in microseconds
+ */
+static inline void rpmi_env_wait_event_timeout(void *eptr,
+					       rpmi_uint32_t timeout_us)
+{
+	/* Do the actual waiting with a timeout if available */
+}
+
+/**
+ * @brief Signal an event and wake up its waiter
+ *
+ * Note: This function can be called from interrupt context and does
+ * nothing if event pointer is NULL.
+ *
+ * @param[in] eptr 	Pointer to event
+ */
+static inline void rpmi_env_signal_event(void *eptr)
+{
+	/* Do the actual signalling if available */
+}
+
+/** @} */
+
+/******************************************************************************/
+
+/**
+ * \defgroup BARRIER_ENV Memory Barrier Environment Functions
+ * @brief Memory ordering functions used by library which can be overridden
+ * by the platform firmware.
+ * @{
+ */
+
+/**
+ * @brief Acquire barrier
+ *
+ * Memory accesses after this barrier are not reordered before the memory
+ * reads preceding it. Used after reading a queue index written by the peer.
+ */
+static inline void rpmi_env_barrier_acquire(void)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Release barrier
+ *
+ * Memory accesses before this barrier are not reordered after the memory
+ * writes following it. Used before publishing a queue index to the peer.
+ */
+static inline void rpmi_env_barrier_release(void)
+{
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/** @} */
+
+/******************************************************************************/
+
+/**
+ * \defgroup ATOMIC_ENV Atomic Environment Functions
+ * @brief Atomic operations used by library which can be overridden by the
+ * platform firmware.
+ * @{
+ */
+
+/**
+ * @brief Atomically set bits in a 32-bit word
+ *
+ * @param[in] ptr 	Pointer to the word
+ * @param[in] bits	Bits to be set
+ */
+static inline void rpmi_env_atomic_or32(rpmi_uint32_t *ptr, rpmi_uint32_t bits)
+{
+	__atomic_fetch_or(ptr, bits, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Atomically AND a 32-bit word with a mask
+ *
+ * @param[in] ptr 	Pointer to the word
+ * @param[in] mask	Bits to be kept
+ */
+static inline void rpmi_env_atomic_and32(rpmi_uint32_t *ptr, rpmi_uint32_t mask)
+{
+	__atomic_fetch_and(ptr, mask, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Atomically exchange a 32-bit word
+ *
+ * @param[in] ptr 	Pointer to the word
+ * @param[in] val	New value of the word
+ * @return rpmi_uint32_t	Old value of the word
+ */
+static inline rpmi_uint32_t rpmi_env_atomic_xchg32(rpmi_uint32_t *ptr,
+						   rpmi_uint32_t val)
+{
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+/** @} */
+
+/******************************************************************************/
+
 /**
  * \defgroup MATH_ENV Integer Math Environment Functions
  * @brief Basic math functions for 32/64 bit integers to be implemented by the
@@ -385,28 +644,85 @@ static inline rpmi_uint32_t rpmi_to_be32(rpmi_uint32_t val)
 #error "Unexpected __BYTE_ORDER__"
 #endif
 
+/**
+ * @brief Check if an endianness is the native endianness
+ *
+ * Note: With LIBRPMI_LE_ONLY, all transports are little-endian so this
+ * is a compile-time constant.
+ *
+ * @param[in] is_be	Endianness (true: Big-endian, false: Little-endian)
+ * @return rpmi_bool_t true if no endian conversion is needed
+ */
+static inline rpmi_bool_t rpmi_xe_is_native(rpmi_bool_t is_be)
+{
+#ifdef LIBRPMI_LE_ONLY
+	is_be = false;
+#endif
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	return !is_be;
+#else
+	return is_be;
+#endif
+}
+
 /**
  * @brief Convert endianness of 16-bit integer based on parameter
  *
+ * Note: With LIBRPMI_LE_ONLY, is_be is ignored and little-endian is used.
+ *
  * @param[in] is_be	Target endianness (true: Big-endian, false: Little-endian)
  * @param[in] val	16-bit integer value
  * @return rpmi_uint16_t Endian converted value
  */
 static inline rpmi_uint16_t rpmi_to_xe16(rpmi_bool_t is_be, rpmi_uint16_t val)
 {
+#ifdef LIBRPMI_LE_ONLY
+	return rpmi_to_le16(val);
+#else
 	return is_be ? rpmi_to_be16(val) : rpmi_to_le16(val);
+#endif
 }
 
 /**
  * @brief Convert endianness of 32-bit integer based on parameter
  *
+ * Note: With LIBRPMI_LE_ONLY, is_be is ignored and little-endian is used.
+ *
  * @param[in] is_be	Target endianness (true: Big-endian, false: Little-endian)
  * @param[in] val	32-bit integer value
  * @return rpmi_uint32_t Endian converted value
  */
 static inline rpmi_uint32_t rpmi_to_xe32(rpmi_bool_t is_be, rpmi_uint32_t val)
 {
+#ifdef LIBRPMI_LE_ONLY
+	return rpmi_to_le32(val);
+#else
 	return is_be ? rpmi_to_be32(val) : rpmi_to_le32(val);
+#endif
+}
+
+/**
+ * @brief Copy an array of 32-bit integers converting endianness
+ *
+ * @param[in] is_be	Target endianness (true: Big-endian, false: Little-endian)
+ * @param[out] dst	destination array
+ * @param[in] src	source array in native endianness
+ * @param[in] count	number of 32-bit integers
+ */
+static inline void rpmi_to_xe32_array(rpmi_bool_t is_be, rpmi_uint32_t *dst,
+				      const rpmi_uint32_t *src,
+				      rpmi_uint32_t count)
+{
+	rpmi_uint32_t i;
+
+	if (rpmi_xe_is_native(is_be)) {
+		rpmi_env_memcpy(dst, src, count * sizeof(*dst));
+		return;
+	}
+
+	/* Branch free loop so that the compiler can vectorize it */
+	for (i = 0; i < count; i++)
+		dst[i] = BSWAP32(src[i]);
 }
 
 /** @} */
@@ -432,6 +748,33 @@ void rpmi_env_writel(rpmi_uint64_t addr, rpmi_uint32_t val);
 
 /******************************************************************************/
 
+/**
+ * \defgroup TIME_ENV Time Environment Functions
+ * @brief Time functions used by library which can be provided by the
+ * platform firmware.
+ * @{
+ */
+
+/**
+ * @brief Get a monotonic timestamp
+ *
+ * Note: Used only for statistics (LIBRPMI_STATS) so the unit of timestamp
+ * is platform specific. The default implementation has no time source and
+ * returns 0 so the platform firmware must replace it with a real counter
+ * (e.g. the RISC-V time CSR) when building with LIBRPMI_STATS, otherwise
+ * all latency fields of struct rpmi_service_stats remain 0.
+ *
+ * @return rpmi_uint64_t	Current timestamp
+ */
+static inline rpmi_uint64_t rpmi_env_get_timestamp(void)
+{
+	return 0;
+}
+
+/** @} */
+
+/******************************************************************************/
+
 /**
  * \defgroup CONSOLE_ENV Console Environment Functions
  * @brief Console functions for logging purpose to be implemented by the platform firmware.
@@ -82,4 +82,54 @@
 	((x / _m) * _m);		\
 })
 
+struct rpmi_context;
+struct rpmi_hsm;
+struct rpmi_service_group;
+
+/**
+ * Attach a system MSI service group to the RPMI context which it is added
+ * to (or detach if cntx is NULL) so that MSI injection can wake it up.
+ */
+void rpmi_service_group_sysmsi_set_context(struct rpmi_service_group *group,
+					   struct rpmi_context *cntx);
+
+/**
+ * Attach a HSM service group to the RPMI context which it is added to (or
+ * detach if cntx is NULL) so that hart state changes mark it pending.
+ */
+void rpmi_service_group_hsm_set_context(struct rpmi_service_group *group,
+					struct rpmi_context *cntx);
+
+/**
+ * Attach a CPPC service group to the RPMI context which it is added to (or
+ * detach if cntx is NULL) so that fast-channel notifications mark it pending.
+ */
+void rpmi_service_group_cppc_set_context(struct rpmi_service_group *group,
+					 struct rpmi_context *cntx);
+
+/**
+ * Attach a performance service group to the RPMI context which it is added
+ * to (or detach if cntx is NULL) so that perf changes queue notifications.
+ */
+void rpmi_service_group_perf_set_context(struct rpmi_service_group *group,
+					 struct rpmi_context *cntx);
+
+/**
+ * Attach a system suspend service group to the RPMI context which it is
+ * added to (or detach if cntx is NULL) so that a suspend request marks it
+ * pending.
+ */
+void rpmi_service_group_syssusp_set_context(struct rpmi_service_group *group,
+					    struct rpmi_context *cntx);
+
+/**
+ * Set the generation of free deferred request entries of a RPMI context
+ * (used by tests to check generation wrap-around)
+ */
+void rpmi_context_set_deferred_generation(struct rpmi_context *cntx,
+					  rpmi_uint32_t generation);
+
+/** Attach a HSM instance and its child instances to a RPMI context */
+void rpmi_hsm_set_context(struct rpmi_hsm *hsm, struct rpmi_context *cntx);
+
 #endif /* __LIBRPMI_INTERNAL_H__ */
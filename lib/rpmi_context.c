@@ -5,6 +5,7 @@
  */
 
 #include <librpmi.h>
+#include "librpmi_internal.h"
 
 #ifdef LIBRPMI_DEBUG
 #define DPRINTF(msg...)		rpmi_env_printf(msg)
@@ -12,15 +13,229 @@
 #define DPRINTF(msg...)
 #endif
 
+/** Maximum number of A2P requests processed as one batch */
+#ifndef LIBRPMI_CONTEXT_MSG_BATCH_COUNT
+#define LIBRPMI_CONTEXT_MSG_BATCH_COUNT		8
+#endif
+
+/**
+ * Number of acknowledgements which can wait in the per-transport backlog
+ * when P2A acknowledgement queue is full (must be at least batch count)
+ */
+#ifndef LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT
+#define LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT	(2 * LIBRPMI_CONTEXT_MSG_BATCH_COUNT)
+#endif
+
+/* Requests of a batch are tracked using 32-bit masks */
+#if LIBRPMI_CONTEXT_MSG_BATCH_COUNT > 32
+#error "LIBRPMI_CONTEXT_MSG_BATCH_COUNT must not be more than 32"
+#endif
+
+#if LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT < LIBRPMI_CONTEXT_MSG_BATCH_COUNT
+#error "LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT must be at least LIBRPMI_CONTEXT_MSG_BATCH_COUNT"
+#endif
+
+/** Maximum number of transports served by a context */
+#ifndef LIBRPMI_CONTEXT_MAX_TRANSPORTS
+#define LIBRPMI_CONTEXT_MAX_TRANSPORTS		4
+#endif
+
+/** Maximum number of requests with deferred acknowledgement in a context */
+#ifndef LIBRPMI_CONTEXT_MAX_DEFERRED
+#define LIBRPMI_CONTEXT_MAX_DEFERRED		8
+#endif
+
+/* Completed deferred requests are tracked using a 32-bit mask */
+#if LIBRPMI_CONTEXT_MAX_DEFERRED > 32
+#error "LIBRPMI_CONTEXT_MAX_DEFERRED must not be more than 32"
+#endif
+
+/*
+ * Deferred request token holds the entry index in bits [7:0] and the entry
+ * generation in bits [31:8] so the generation wraps at 24 bits
+ */
+#define LIBRPMI_CONTEXT_DEFERRED_TOKEN(__gen, __idx)	(((__gen) << 8) | (__idx))
+#define LIBRPMI_CONTEXT_DEFERRED_TOKEN_INDEX(__token)	((__token) & 0xff)
+#define LIBRPMI_CONTEXT_DEFERRED_TOKEN_GEN(__token)	((__token) >> 8)
+#define LIBRPMI_CONTEXT_DEFERRED_GEN_MASK		0xffffff
+
+/**
+ * Number of service group IDs at the start of the experimental and vendor
+ * ranges which are looked up without groups_lock
+ */
+#ifndef LIBRPMI_CONTEXT_IMPL_DISPATCH_COUNT
+#define LIBRPMI_CONTEXT_IMPL_DISPATCH_COUNT	16
+#endif
+
+/** Default period (in calls) of sweeping events of all service groups */
+#ifndef LIBRPMI_CONTEXT_EVENT_SWEEP_PERIOD
+#define LIBRPMI_CONTEXT_EVENT_SWEEP_PERIOD	8
+#endif
+
+/** Timeout of rpmi_context_run() when work is left or groups need sweeping */
+#ifndef LIBRPMI_CONTEXT_RUN_TIMEOUT_US
+#define LIBRPMI_CONTEXT_RUN_TIMEOUT_US		1000
+#endif
+
+/** Per-transport state of a context */
+struct rpmi_context_transport {
+	/** Transport instance */
+	struct rpmi_transport *trans;
+
+	/** Temporary request messages (batch of LIBRPMI_CONTEXT_MSG_BATCH_COUNT) */
+	struct rpmi_message *req_msg;
+
+	/**
+	 * Ring of acknowledgement messages waiting for space in P2A
+	 * acknowledgement queue (LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT slots)
+	 */
+	struct rpmi_message *ack_msg;
+
+	/**
+	 * Acknowledgement messages of deferred requests received on the
+	 * transport (LIBRPMI_CONTEXT_MAX_DEFERRED slots, one per entry of
+	 * the deferred array of the context)
+	 */
+	struct rpmi_message *deferred_msg;
+
+	/** Index of the oldest acknowledgement in the backlog ring */
+	rpmi_uint32_t ack_head;
+
+	/** Number of acknowledgements in the backlog ring */
+	rpmi_uint32_t ack_count;
+
+	/** Doorbell requested by an acknowledgement in the backlog ring */
+	rpmi_bool_t ack_doorbell;
+
+	/** System MSI index of the P2A doorbell (unused for primary transport) */
+	rpmi_uint32_t p2a_msi_index;
+
+	/** Number of times request processing stopped due to full P2A queue */
+	rpmi_uint64_t ack_stalls;
+
+	/** Number of posted requests skipped because a later one supersedes */
+	rpmi_uint64_t superseded;
+};
+
+/** Request whose acknowledgement is sent after the handler returns */
+struct rpmi_context_deferred {
+	/** Transport of the request (NULL if the entry is free) */
+	struct rpmi_transport *trans;
+
+	/**
+	 * Acknowledgement message with native endianness header taken from
+	 * the preallocated deferred_msg slots of the request transport
+	 */
+	struct rpmi_message *msg;
+
+	/** Doorbell requested by the request */
+	rpmi_bool_t doorbell;
+
+	/**
+	 * Incremented (modulo LIBRPMI_CONTEXT_DEFERRED_GEN_MASK + 1) upon
+	 * reuse of the entry to reject stale tokens
+	 */
+	rpmi_uint32_t generation;
+};
+
+/** Notification state of a service group for one transport of a context */
+struct rpmi_context_notify {
+	/** Bitmap of notification events enabled through the transport */
+	rpmi_uint32_t enabled;
+
+	/** Queued notification events in native endianness */
+	rpmi_uint32_t *buf;
+
+	/** Number of words queued in buf */
+	rpmi_uint32_t words;
+};
+
 struct rpmi_base_group;
 
+/** Precomputed dispatch information of a service */
+struct rpmi_context_dispatch_entry {
+	/** Service (NULL if service ID is not valid) */
+	struct rpmi_service *service;
+
+	/** Minimum A2P request data length of the service */
+	rpmi_uint16_t min_a2p_request_datalen;
+
+	/** Request data bytes identifying the target of posted requests */
+	rpmi_uint16_t coalesce_key_len;
+
+	/** ENABLE_NOTIFICATION service implemented by the context */
+	rpmi_bool_t enable_notification;
+
+	/**
+	 * Request handler (not supported handler as fallback and NULL only
+	 * if the service is implemented by the context)
+	 */
+	enum rpmi_error (*process_a2p_request)(struct rpmi_service_group *group,
+					       struct rpmi_service *service,
+					       struct rpmi_transport *trans,
+					       rpmi_uint16_t request_datalen,
+					       const rpmi_uint8_t *request_data,
+					       rpmi_uint16_t *response_datalen,
+					       rpmi_uint8_t *response_data);
+
+#ifdef LIBRPMI_STATS
+	/** Statistics of the service */
+	struct rpmi_service_stats stats;
+#endif
+};
+
+/** Precomputed dispatch table of a service group in a context */
+struct rpmi_context_dispatch {
+	/** Service group */
+	struct rpmi_service_group *group;
+
+	/** Lock of the service group */
+	void *lock;
+
+	/** Number of entries (same as max_service_id of the group) */
+	rpmi_uint32_t num_services;
+
+	/** Requests to the service group are processed first in a batch */
+	rpmi_bool_t high_priority;
+
+	/** Entry for service IDs beyond num_services */
+	struct rpmi_context_dispatch_entry invalid_entry;
+
+	/** Non-zero if events of the service group are pending */
+	rpmi_uint32_t events_pending;
+
+	/**
+	 * Notification state indexed like the transports array of the
+	 * context so each transport has its own subscription
+	 */
+	struct rpmi_context_notify notify[LIBRPMI_CONTEXT_MAX_TRANSPORTS];
+
+	/** Capacity of each notification buffer in words */
+	rpmi_uint32_t notify_max_words;
+
+	/** Next dispatch table retired by rpmi_context_remove_group() */
+	struct rpmi_context_dispatch *retired_next;
+
+	/** Entries indexed by service ID */
+	struct rpmi_context_dispatch_entry entries[];
+};
+
 struct rpmi_context {
 	/** Name of the context */
 	const char *name;
 
-	/** Underlying transport instance of the context */
+	/** Underlying (primary) transport instance of the context */
 	struct rpmi_transport *trans;
 
+	/** Number of transports served by the context */
+	rpmi_uint32_t num_transports;
+
+	/** Transports served by the context (primary transport is first) */
+	struct rpmi_context_transport transports[LIBRPMI_CONTEXT_MAX_TRANSPORTS];
+
+	/** Transport to be polled first in next rpmi_context_poll() */
+	rpmi_uint32_t poll_index;
+
 	/** Maximum number of service groups handled by the context */
 	rpmi_uint32_t max_num_groups;
 
@@ -36,17 +251,84 @@ struct rpmi_context {
 	/** Lock to synchronize num_groups and groups array access (optional) */
 	void *groups_lock;
 
-	/** Temporary request message */
-	struct rpmi_message *req_msg;
+	/** Dispatch tables of service groups in the same order as groups array */
+	struct rpmi_context_dispatch **dispatch;
 
-	/** Temporary acknowledgement message */
-	struct rpmi_message *ack_msg;
+	/**
+	 * Dispatch tables of standard service groups indexed by service group
+	 * ID. Entries are published with a release barrier so lookups don't
+	 * need groups_lock.
+	 */
+	struct rpmi_context_dispatch *std_dispatch[RPMI_SRVGRP_ID_MAX_COUNT];
+
+	/**
+	 * Dispatch tables of the first LIBRPMI_CONTEXT_IMPL_DISPATCH_COUNT
+	 * experimental and vendor service group IDs published like the
+	 * std_dispatch entries
+	 */
+	struct rpmi_context_dispatch *exp_dispatch[LIBRPMI_CONTEXT_IMPL_DISPATCH_COUNT];
+	struct rpmi_context_dispatch *vendor_dispatch[LIBRPMI_CONTEXT_IMPL_DISPATCH_COUNT];
+
+	/**
+	 * Dispatch tables of removed service groups which are freed only by
+	 * rpmi_context_destroy() since lookups may still be using them
+	 */
+	struct rpmi_context_dispatch *retired;
 
 	/** Base service group */
 	struct rpmi_service_group *base_group;
 
 	/** System MSI service group */
 	struct rpmi_service_group *sysmsi_group;
+
+	/** Event to wake up rpmi_context_run() (NULL if not supported) */
+	void *event;
+
+	/** Bitmap of LIBRPMI_CONTEXT_SIGNAL_xyz pending for rpmi_context_run() */
+	rpmi_uint32_t signalled;
+
+	/** Coalesce posted requests to the same target within a batch */
+	rpmi_bool_t coalesce;
+
+	/**
+	 * Transport of the request being processed by a service handler.
+	 * A2P requests of a context are processed by one thread at a time
+	 * so the request being processed is tracked per context.
+	 */
+	struct rpmi_transport *cur_trans;
+
+	/** Header of the request being processed by a service handler */
+	const struct rpmi_message_header *cur_hdr;
+
+	/** Acknowledgement of the request being processed is deferred */
+	rpmi_bool_t cur_deferred;
+
+	/** Requests with deferred acknowledgement */
+	struct rpmi_context_deferred deferred[LIBRPMI_CONTEXT_MAX_DEFERRED];
+
+	/** Bitmap of deferred requests completed but not yet acknowledged */
+	rpmi_uint32_t deferred_done;
+
+	/** Lock to synchronize notification state of all service groups */
+	void *notify_lock;
+
+	/** Non-zero if notification events are queued */
+	rpmi_uint32_t notify_pending;
+
+	/** Token of the next notification message */
+	rpmi_uint16_t notify_token;
+
+	/** Buffer to build notification messages */
+	struct rpmi_message *notify_msg;
+
+	/** Number of service groups supporting notification events */
+	rpmi_uint32_t num_notify_groups;
+
+	/** Sweep events of all groups every event_sweep_period calls (0: never) */
+	rpmi_uint32_t event_sweep_period;
+
+	/** Calls of rpmi_context_process_all_events() since the last sweep */
+	rpmi_uint32_t event_sweep_count;
 };
 
 struct rpmi_base_group {
@@ -155,7 +437,8 @@ static enum rpmi_error rpmi_base_probe_group(struct rpmi_service_group *group,
 	*response_datalen = 2 * sizeof(*resp);
 	resp[0] = rpmi_to_xe32(trans->is_be, (rpmi_uint32_t)RPMI_SUCCESS);
 	
-	srvgrp = rpmi_context_find_group(base->cntx, probe_id);
+	srvgrp = (probe_id <= RPMI_SRVGRP_VENDOR_END) ?
+		 rpmi_context_find_group(base->cntx, probe_id) : NULL;
 	ver = srvgrp ? srvgrp->servicegroup_version : 0;
 
 	resp[1] = rpmi_to_xe32(trans->is_be, ver);
@@ -179,6 +462,10 @@ static enum rpmi_error rpmi_base_get_attributes(struct rpmi_service_group *group
 	flags |= (cntx->privilege_level == RPMI_PRIVILEGE_M_MODE) ?
 					RPMI_BASE_FLAGS_F0_PRIVILEGE : 0;
 
+	/* Notifications need a P2A channel and a group raising events */
+	flags |= (trans->is_p2a_channel && cntx->num_notify_groups) ?
+					RPMI_BASE_FLAGS_F0_EV_NOTIFY : 0;
+
 	*response_datalen = 5 * sizeof(*resp);
 	resp[0] = rpmi_to_xe32(trans->is_be, (rpmi_uint32_t)RPMI_SUCCESS);
 	resp[1] = rpmi_to_xe32(trans->is_be, flags);
@@ -307,196 +594,132 @@ static enum rpmi_error rpmi_service_notsupp_a2p_request(struct rpmi_service_grou
 	return RPMI_SUCCESS;
 }
 
-void rpmi_context_process_a2p_request(struct rpmi_context *cntx)
+static const struct rpmi_context_dispatch_entry rpmi_context_notsupp_entry = {
+	.service = NULL,
+	.min_a2p_request_datalen = 0,
+	.process_a2p_request = rpmi_service_notsupp_a2p_request,
+};
+
+static struct rpmi_context_dispatch *rpmi_context_dispatch_create(
+					struct rpmi_context *cntx,
+					struct rpmi_service_group *group)
 {
-	rpmi_bool_t do_process, do_acknowledge;
-	struct rpmi_message *rmsg, *amsg;
-	struct rpmi_service_group *group;
+	struct rpmi_context_dispatch_entry *entry;
+	struct rpmi_context_dispatch *dispatch;
+	rpmi_uint32_t i, notify_words = 0;
 	struct rpmi_service *service;
-	struct rpmi_transport *trans;
-	enum rpmi_error rc;
+	rpmi_uint32_t *buf;
+
+	/* Queued events must fit in one message of the smallest transport */
+	if (group->notification_events)
+		notify_words = RPMI_MSG_DATA_SIZE(cntx->trans->slot_size) /
+			       sizeof(rpmi_uint32_t);
+
+	dispatch = rpmi_env_zalloc(sizeof(*dispatch) +
+				   group->max_service_id * sizeof(*entry) +
+				   LIBRPMI_CONTEXT_MAX_TRANSPORTS *
+				   notify_words * sizeof(rpmi_uint32_t));
+	if (!dispatch)
+		return NULL;
 
-	if (!cntx) {
-		DPRINTF("%s: invalid parameters\n", __func__);
-		return;
+	dispatch->group = group;
+	dispatch->lock = group->lock;
+	dispatch->num_services = group->max_service_id;
+	dispatch->high_priority =
+		(group->priority >= RPMI_SRVGRP_PRIORITY_HIGH) ? true : false;
+	dispatch->invalid_entry = rpmi_context_notsupp_entry;
+	if (notify_words) {
+		buf = (void *)&dispatch->entries[dispatch->num_services];
+		for (i = 0; i < LIBRPMI_CONTEXT_MAX_TRANSPORTS; i++)
+			dispatch->notify[i].buf = &buf[i * notify_words];
+		dispatch->notify_max_words = notify_words;
 	}
-
-	trans = cntx->trans;
-	rmsg = cntx->req_msg;
-	amsg = cntx->ack_msg;
-	while (!rpmi_transport_dequeue(trans, RPMI_QUEUE_A2P_REQ, rmsg)) {
-		group = rpmi_context_find_group(cntx, rmsg->header.servicegroup_id);
-		if (!group) {
-			DPRINTF("%s: %s: service group ID 0x%x not found\n",
-				__func__, cntx->name, rmsg->header.servicegroup_id);
-			continue;
-		}
-
-		service = NULL;
-		if (rmsg->header.service_id < group->max_service_id)
-			service = &group->services[rmsg->header.service_id];
-
-		amsg->header.flags = RPMI_MSG_ACKNOWLEDGEMENT;
-		amsg->header.service_id = rmsg->header.service_id;
-		amsg->header.servicegroup_id = rmsg->header.servicegroup_id;
-		amsg->header.datalen = 0;
-		amsg->header.token = rmsg->header.token;
-
-		do_process = false;
-		do_acknowledge = false;
-		switch (rmsg->header.flags & RPMI_MSG_FLAGS_TYPE) {
-		case RPMI_MSG_NORMAL_REQUEST:
-			do_process = true;
-			do_acknowledge = true;
-			break;
-		case RPMI_MSG_POSTED_REQUEST:
-			do_process = true;
-			break;
-		case RPMI_MSG_ACKNOWLEDGEMENT:
-			DPRINTF("%s: %s: group %s ignoring acknowledgement from a2p queue\n",
-				__func__, cntx->name, group->name);
-			break;
-		case RPMI_MSG_NOTIFICATION:
-			DPRINTF("%s: %s: group %s can't handle notification from a2p queue\n",
-				__func__, cntx->name, group->name);
-			break;
-		default:
-			break;
-		}
-
-		if (!do_process)
-			continue;
-
-		rpmi_env_lock(group->lock);
-		if (service && service->process_a2p_request &&
-		    rmsg->header.datalen >= service->min_a2p_request_datalen)
-			rc = service->process_a2p_request(group, service, trans,
-							rmsg->header.datalen, rmsg->data,
-							&amsg->header.datalen, amsg->data);
-		else
-			rc = rpmi_service_notsupp_a2p_request(group, service, trans,
-							rmsg->header.datalen, rmsg->data,
-							&amsg->header.datalen, amsg->data);
-		rpmi_env_unlock(group->lock);
-
-		if (rc) {
-			DPRINTF("%s: %s: group %s a2p request failed (error %d)\n",
-				__func__, cntx->name, group->name, rc);
-			DPRINTF("%s: %s: flags 0x%x service_id 0x%x servicegroup_id 0x%x\n",
-				__func__, cntx->name,
-				rmsg->header.flags, rmsg->header.service_id,
-				rmsg->header.servicegroup_id);
-			DPRINTF("%s: %s: datalen 0x%x token 0x%x\n",
-				__func__, cntx->name,
-				rmsg->header.datalen, rmsg->header.token);
-			continue;
+	for (i = 0; i < dispatch->num_services; i++) {
+		entry = &dispatch->entries[i];
+		service = (group->services) ? &group->services[i] : NULL;
+		if (service && !service->process_a2p_request &&
+		    i == RPMI_BASE_SRV_ENABLE_NOTIFICATION && notify_words) {
+			entry->service = service;
+			entry->min_a2p_request_datalen = 2 * sizeof(rpmi_uint32_t);
+			entry->enable_notification = true;
+		} else if (service && service->process_a2p_request) {
+			entry->service = service;
+			entry->min_a2p_request_datalen = service->min_a2p_request_datalen;
+			entry->coalesce_key_len = service->coalesce_key_len;
+			entry->process_a2p_request = service->process_a2p_request;
+		} else {
+			*entry = rpmi_context_notsupp_entry;
+			entry->service = service;
 		}
-
-		if (!do_acknowledge)
-			continue;
-
-		/**
-		 * Try pushing the message in queue until successful
-		 * or any other error apart from input/output error
-		 * in case of queue full.
-		 */
-		do {
-			rc = rpmi_transport_enqueue(trans, RPMI_QUEUE_P2A_ACK, amsg);
-		} while (rc == RPMI_ERR_IO);
-
-		if (rc) {
-			DPRINTF("%s: %s: group %s p2a acknowledgement failed (error %d)\n",
-				__func__, cntx->name, group->name, rc);
-		}
-
-		if ((rmsg->header.flags & RPMI_MSG_FLAGS_DOORBELL) &&
-		    cntx->sysmsi_group)
-			rpmi_service_group_sysmsi_inject_p2a(cntx->sysmsi_group);
 	}
+
+	return dispatch;
 }
 
-void rpmi_context_process_group_events(struct rpmi_context *cntx,
-				       rpmi_uint16_t servicegroup_id)
+#ifdef LIBRPMI_STATS
+static void rpmi_context_update_stats(struct rpmi_context_dispatch_entry *entry,
+				      rpmi_bool_t notsupp, enum rpmi_error rc,
+				      rpmi_uint64_t latency)
 {
-	struct rpmi_service_group *group;
-	enum rpmi_error rc;
-
-	if (!cntx) {
-		DPRINTF("%s: invalid parameters\n", __func__);
-		return;
-	}
-
-	group = rpmi_context_find_group(cntx, servicegroup_id);
-	if (!group) {
-		DPRINTF("%s: %s: group not found for servicegroup_id 0x%x\n",
-			__func__, cntx->name, servicegroup_id);
-		return;
-	}
-	if (!group->process_events) {
-		DPRINTF("%s: %s: group %s does not support events\n",
-			__func__, cntx->name, group->name);
-		return;
-	}
-
-	rpmi_env_lock(group->lock);
-	rc = group->process_events(group);
-	rpmi_env_unlock(group->lock);
-	if (rc && rc != RPMI_ERR_BUSY) {
-		DPRINTF("%s: %s: group %s failed with error %d\n",
-			__func__, cntx->name, group->name, rc);
-	}
+	struct rpmi_service_stats *stats = &entry->stats;
+
+	if (!stats->request_count || latency < stats->min_latency)
+		stats->min_latency = latency;
+	if (latency > stats->max_latency)
+		stats->max_latency = latency;
+	stats->total_latency += latency;
+	stats->request_count++;
+	if (rc)
+		stats->error_count++;
+	if (notsupp)
+		stats->notsupp_count++;
 }
+#endif
 
-void rpmi_context_process_all_events(struct rpmi_context *cntx)
+/*
+ * Get the entry of a service group ID in the direct-indexed dispatch tables
+ * or NULL if the ID is only found by scanning the groups array
+ */
+static struct rpmi_context_dispatch **rpmi_context_dispatch_slot(
+					struct rpmi_context *cntx,
+					rpmi_uint16_t servicegroup_id)
 {
-	struct rpmi_service_group *group;
-	enum rpmi_error rc;
-	rpmi_uint32_t i;
-
-	if (!cntx) {
-		DPRINTF("%s: invalid parameters\n", __func__);
-		return;
-	}
-
-	rpmi_env_lock(cntx->groups_lock);
-
-	for (i = 0; i < cntx->num_groups; i++) {
-		group = cntx->groups[i];
-		if (!group->process_events)
-			continue;
+	rpmi_uint32_t offset;
 
-		rpmi_env_unlock(cntx->groups_lock);
+	if (servicegroup_id < RPMI_SRVGRP_ID_MAX_COUNT)
+		return &cntx->std_dispatch[servicegroup_id];
 
-		rpmi_env_lock(group->lock);
-		rc = group->process_events(group);
-		rpmi_env_unlock(group->lock);
-		if (rc && rc != RPMI_ERR_BUSY) {
-			DPRINTF("%s: %s: group %s failed with error %d\n",
-				__func__, cntx->name, group->name, rc);
-		}
+	offset = (rpmi_uint32_t)servicegroup_id - RPMI_SRVGRP_EXPERIMENTAL_START;
+	if (offset < LIBRPMI_CONTEXT_IMPL_DISPATCH_COUNT)
+		return &cntx->exp_dispatch[offset];
 
-		rpmi_env_lock(cntx->groups_lock);
-	}
+	offset = (rpmi_uint32_t)servicegroup_id - RPMI_SRVGRP_VENDOR_START;
+	if (offset < LIBRPMI_CONTEXT_IMPL_DISPATCH_COUNT)
+		return &cntx->vendor_dispatch[offset];
 
-	rpmi_env_unlock(cntx->groups_lock);
+	return NULL;
 }
 
-struct rpmi_service_group *rpmi_context_find_group(struct rpmi_context *cntx,
-						   rpmi_uint16_t servicegroup_id)
+static struct rpmi_context_dispatch *rpmi_context_find_dispatch(
+					struct rpmi_context *cntx,
+					rpmi_uint16_t servicegroup_id)
 {
-	struct rpmi_service_group *ret = NULL;
+	struct rpmi_context_dispatch **slot, *ret = NULL;
 	rpmi_uint32_t i;
 
-	if (!cntx) {
-		DPRINTF("%s: invalid parameters\n", __func__);
-		return NULL;
+	/* Service groups with a table entry are looked up without groups_lock */
+	slot = rpmi_context_dispatch_slot(cntx, servicegroup_id);
+	if (slot) {
+		ret = *slot;
+		rpmi_env_barrier_acquire();
+		return ret;
 	}
 
 	rpmi_env_lock(cntx->groups_lock);
 
 	for (i = 0; i < cntx->num_groups; i++) {
 		if (cntx->groups[i]->servicegroup_id == servicegroup_id) {
-			ret = cntx->groups[i];
+			ret = cntx->dispatch[i];
 			break;
 		}
 	}
@@ -506,44 +729,1144 @@ struct rpmi_service_group *rpmi_context_find_group(struct rpmi_context *cntx,
 	return ret;
 }
 
-static enum rpmi_error rpmi_context_verify_privilege_level(struct rpmi_context *cntx,
-						      struct rpmi_service_group *group)
+/* Get the index of a transport in the transports array of a context */
+static rpmi_uint32_t rpmi_context_transport_index(struct rpmi_context *cntx,
+						  struct rpmi_transport *trans)
 {
-	if (!group->privilege_level_bitmap)
-		return RPMI_ERR_INVALID_PARAM;
+	rpmi_uint32_t i;
 
-	if (group->privilege_level_bitmap & (1U << cntx->privilege_level))
-		return RPMI_SUCCESS;
+	for (i = 0; i < cntx->num_transports; i++) {
+		if (cntx->transports[i].trans == trans)
+			break;
+	}
 
-	return RPMI_ERR_DENIED;
+	return i;
 }
 
-enum rpmi_error rpmi_context_add_group(struct rpmi_context *cntx,
-				       struct rpmi_service_group *group)
+/* ENABLE_NOTIFICATION service of service groups raising notification events */
+static void rpmi_context_enable_notification(struct rpmi_context *cntx,
+					     struct rpmi_context_dispatch *dispatch,
+					     struct rpmi_transport *trans,
+					     const rpmi_uint8_t *request_data,
+					     rpmi_uint16_t *response_datalen,
+					     rpmi_uint8_t *response_data)
 {
-	enum rpmi_error rc = RPMI_SUCCESS;
-	rpmi_uint32_t i;
+	const rpmi_uint32_t *req = (const void *)request_data;
+	rpmi_uint32_t *resp = (void *)response_data;
+	enum rpmi_error status = RPMI_SUCCESS;
+	rpmi_uint32_t event_id, state, bit;
+	struct rpmi_context_notify *notify;
+	rpmi_uint32_t index;
+
+	event_id = rpmi_to_xe32(trans->is_be, req[0]);
+	state = rpmi_to_xe32(trans->is_be, req[1]);
+	bit = (event_id < 32) ? (1U << event_id) : 0;
+	index = rpmi_context_transport_index(cntx, trans);
+
+	rpmi_env_lock(cntx->notify_lock);
+
+	if (!(dispatch->group->notification_events & bit) ||
+	    !trans->is_p2a_channel || index >= cntx->num_transports) {
+		status = RPMI_ERR_NOTSUPP;
+		goto done;
+	}
 
-	if (!cntx || !group) {
-		DPRINTF("%s: invalid parameters\n", __func__);
-		return RPMI_ERR_INVALID_PARAM;
+	/* Events are enabled separately for each transport */
+	notify = &dispatch->notify[index];
+	switch (state) {
+	case RPMI_NOTIF_STATE_DISABLE:
+		notify->enabled &= ~bit;
+		if (!notify->enabled)
+			notify->words = 0;
+		break;
+	case RPMI_NOTIF_STATE_ENABLE:
+		notify->enabled |= bit;
+		break;
+	case RPMI_NOTIF_STATE_RETURN:
+		break;
+	default:
+		status = RPMI_ERR_INVALID_PARAM;
+		break;
 	}
 
-	rpmi_env_lock(cntx->groups_lock);
+	resp[1] = rpmi_to_xe32(trans->is_be,
+			(notify->enabled & bit) ? RPMI_NOTIF_STATE_ENABLE :
+						  RPMI_NOTIF_STATE_DISABLE);
 
-	if (cntx->max_num_groups <= cntx->num_groups) {
-		DPRINTF("%s: %s: no space to add group %s\n",
-			__func__, cntx->name, group->name);
-		rc = RPMI_ERR_IO;
-		goto fail_unlock;
-	}
+done:
+	rpmi_env_unlock(cntx->notify_lock);
 
-	for (i = 0; i < cntx->num_groups; i++) {
-		if (cntx->groups[i] == group) {
-			DPRINTF("%s: %s: group %s alread added\n",
-				__func__, cntx->name, group->name);
-			rc = RPMI_ERR_ALREADY;
-			goto fail_unlock;
+	resp[0] = rpmi_to_xe32(trans->is_be, (rpmi_uint32_t)status);
+	*response_datalen = (status) ? sizeof(*resp) : 2 * sizeof(*resp);
+}
+
+/*
+ * Process one A2P request and build the acknowledgement in ahdr and adata.
+ * The dispatch table of the request service group is resolved by the caller
+ * (NULL if not found). Both headers are in native endianness. Returns true
+ * if the acknowledgement needs to be sent back to the application processor.
+ */
+static rpmi_bool_t rpmi_context_process_msg(struct rpmi_context *cntx,
+					    struct rpmi_transport *trans,
+					    struct rpmi_context_dispatch *dispatch,
+					    const struct rpmi_message_header *rhdr,
+					    const rpmi_uint8_t *rdata,
+					    struct rpmi_message_header *ahdr,
+					    rpmi_uint8_t *adata)
+{
+	struct rpmi_context_dispatch_entry *entry;
+	rpmi_bool_t do_process, do_acknowledge;
+#ifdef LIBRPMI_STATS
+	rpmi_uint64_t start;
+#endif
+	struct rpmi_service_group *group;
+	enum rpmi_error rc;
+
+	if (!dispatch) {
+		DPRINTF("%s: %s: service group ID 0x%x not found\n",
+			__func__, cntx->name, rhdr->servicegroup_id);
+		return false;
+	}
+
+	group = dispatch->group;
+	entry = (rhdr->service_id < dispatch->num_services) ?
+		&dispatch->entries[rhdr->service_id] : &dispatch->invalid_entry;
+
+	ahdr->flags = RPMI_MSG_ACKNOWLEDGEMENT;
+	ahdr->service_id = rhdr->service_id;
+	ahdr->servicegroup_id = rhdr->servicegroup_id;
+	ahdr->datalen = 0;
+	ahdr->token = rhdr->token;
+
+	do_process = false;
+	do_acknowledge = false;
+	switch (rhdr->flags & RPMI_MSG_FLAGS_TYPE) {
+	case RPMI_MSG_NORMAL_REQUEST:
+		do_process = true;
+		do_acknowledge = true;
+		break;
+	case RPMI_MSG_POSTED_REQUEST:
+		do_process = true;
+		break;
+	case RPMI_MSG_ACKNOWLEDGEMENT:
+		DPRINTF("%s: %s: group %s ignoring acknowledgement from a2p queue\n",
+			__func__, cntx->name, group->name);
+		break;
+	case RPMI_MSG_NOTIFICATION:
+		DPRINTF("%s: %s: group %s can't handle notification from a2p queue\n",
+			__func__, cntx->name, group->name);
+		break;
+	default:
+		break;
+	}
+
+	if (!do_process)
+		return false;
+
+	/*
+	 * The header is not trusted so a data length beyond the slot would
+	 * make the service read past the request in the queue or copy buffer.
+	 */
+	if (rhdr->datalen > trans->slot_size - sizeof(*rhdr)) {
+		DPRINTF("%s: %s: group %s datalen 0x%x exceeds slot size\n",
+			__func__, cntx->name, group->name, rhdr->datalen);
+		ahdr->datalen = sizeof(rpmi_uint32_t);
+		((rpmi_uint32_t *)adata)[0] =
+			rpmi_to_xe32(trans->is_be, (rpmi_uint32_t)RPMI_ERR_INVALID_PARAM);
+		return do_acknowledge;
+	}
+
+	cntx->cur_trans = trans;
+	cntx->cur_hdr = rhdr;
+	rpmi_env_lock(dispatch->lock);
+#ifdef LIBRPMI_STATS
+	start = rpmi_env_get_timestamp();
+#endif
+	rc = RPMI_SUCCESS;
+	if (rhdr->datalen < entry->min_a2p_request_datalen)
+		rc = rpmi_service_notsupp_a2p_request(group, entry->service, trans,
+						rhdr->datalen, rdata,
+						&ahdr->datalen, adata);
+	else if (entry->enable_notification)
+		rpmi_context_enable_notification(cntx, dispatch, trans, rdata,
+						 &ahdr->datalen, adata);
+	else
+		rc = entry->process_a2p_request(group, entry->service, trans,
+						rhdr->datalen, rdata,
+						&ahdr->datalen, adata);
+#ifdef LIBRPMI_STATS
+	rpmi_context_update_stats(entry,
+			entry->process_a2p_request == rpmi_service_notsupp_a2p_request ||
+			rhdr->datalen < entry->min_a2p_request_datalen,
+			rc, rpmi_env_get_timestamp() - start);
+#endif
+	rpmi_env_unlock(dispatch->lock);
+	cntx->cur_trans = NULL;
+	cntx->cur_hdr = NULL;
+
+	/* Acknowledgement is sent by rpmi_context_complete_request() */
+	if (cntx->cur_deferred) {
+		cntx->cur_deferred = false;
+		return false;
+	}
+
+	if (rc) {
+		DPRINTF("%s: %s: group %s a2p request failed (error %d)\n",
+			__func__, cntx->name, group->name, rc);
+		DPRINTF("%s: %s: flags 0x%x service_id 0x%x servicegroup_id 0x%x\n",
+			__func__, cntx->name,
+			rhdr->flags, rhdr->service_id,
+			rhdr->servicegroup_id);
+		DPRINTF("%s: %s: datalen 0x%x token 0x%x\n",
+			__func__, cntx->name,
+			rhdr->datalen, rhdr->token);
+		return false;
+	}
+
+	return do_acknowledge;
+}
+
+static inline struct rpmi_message *rpmi_context_backlog_msg(
+					struct rpmi_context_transport *ctrans,
+					rpmi_uint32_t index)
+{
+	if (index >= LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT)
+		index -= LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT;
+
+	return rpmi_transport_batch_msg(ctrans->trans, ctrans->ack_msg, index);
+}
+
+/*
+ * Ring the P2A doorbell of a transport. The primary transport uses the P2A
+ * doorbell of the system MSI service group whereas other transports use
+ * the system MSI given to rpmi_context_add_transport().
+ */
+static void rpmi_context_ring_doorbell(struct rpmi_context *cntx,
+				       struct rpmi_context_transport *ctrans)
+{
+	if (!cntx->sysmsi_group)
+		return;
+
+	if (ctrans == &cntx->transports[0])
+		rpmi_service_group_sysmsi_inject_p2a(cntx->sysmsi_group);
+	else
+		rpmi_service_group_sysmsi_inject(cntx->sysmsi_group,
+						 ctrans->p2a_msi_index);
+}
+
+/*
+ * Push acknowledgements from the backlog ring to the P2A acknowledgement
+ * queue without waiting. Returns the number of acknowledgements left in the
+ * backlog ring.
+ */
+static rpmi_uint32_t rpmi_context_flush_acks(struct rpmi_context *cntx,
+					     struct rpmi_context_transport *ctrans)
+{
+	rpmi_uint32_t chunk, sent, total = 0;
+
+	while (ctrans->ack_count) {
+		/* Ring wraps so push at most up to the end of the ring */
+		chunk = RPMI_MIN(ctrans->ack_count,
+				 LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT - ctrans->ack_head);
+		sent = rpmi_transport_enqueue_batch(ctrans->trans, RPMI_QUEUE_P2A_ACK,
+				rpmi_context_backlog_msg(ctrans, ctrans->ack_head),
+				chunk);
+
+		ctrans->ack_head += sent;
+		if (ctrans->ack_head >= LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT)
+			ctrans->ack_head -= LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT;
+		ctrans->ack_count -= sent;
+		total += sent;
+
+		if (sent < chunk)
+			break;
+	}
+
+	/* Single doorbell for all acknowledgements pushed together */
+	if (total && ctrans->ack_doorbell)
+		rpmi_context_ring_doorbell(cntx, ctrans);
+	if (!ctrans->ack_count)
+		ctrans->ack_doorbell = false;
+
+	return ctrans->ack_count;
+}
+
+static inline void rpmi_context_convert_header(struct rpmi_transport *trans,
+					       struct rpmi_message_header *dst,
+					       const struct rpmi_message_header *src)
+{
+	dst->flags = src->flags;
+	dst->service_id = src->service_id;
+	dst->servicegroup_id = rpmi_to_xe16(trans->is_be, src->servicegroup_id);
+	dst->datalen = rpmi_to_xe16(trans->is_be, src->datalen);
+	dst->token = rpmi_to_xe16(trans->is_be, src->token);
+}
+
+/*
+ * Check if a posted request is superseded by a later posted request of the
+ * same service to the same target (first coalesce_key_len bytes of request
+ * data) among requests next to count - 1 of the batch. Any other request to
+ * the same service group in between stops the search to preserve ordering.
+ * Requests of the batch are in transport queue slots for in-place processing
+ * otherwise in the req_msg array of the transport.
+ */
+static rpmi_bool_t rpmi_context_is_superseded(struct rpmi_context *cntx,
+					      struct rpmi_context_transport *ctrans,
+					      struct rpmi_context_dispatch *dispatch,
+					      const struct rpmi_message_header *rhdr,
+					      const rpmi_uint8_t *rdata,
+					      rpmi_uint32_t next,
+					      rpmi_uint32_t count,
+					      rpmi_bool_t in_place)
+{
+	struct rpmi_transport *trans = ctrans->trans;
+	struct rpmi_message_header ohdr;
+	struct rpmi_message *omsg;
+	rpmi_uint16_t key_len;
+
+	if (!cntx->coalesce ||
+	    (rhdr->flags & RPMI_MSG_FLAGS_TYPE) != RPMI_MSG_POSTED_REQUEST)
+		return false;
+
+	if (!dispatch || rhdr->service_id >= dispatch->num_services)
+		return false;
+
+	key_len = dispatch->entries[rhdr->service_id].coalesce_key_len;
+	if (!key_len || rhdr->datalen < key_len)
+		return false;
+
+	for (; next < count; next++) {
+		if (in_place) {
+			omsg = rpmi_transport_peek_slot(trans, RPMI_QUEUE_A2P_REQ, next);
+			if (!omsg)
+				break;
+			rpmi_context_convert_header(trans, &ohdr, &omsg->header);
+		} else {
+			omsg = rpmi_transport_batch_msg(trans, ctrans->req_msg, next);
+			ohdr = omsg->header;
+		}
+
+		if (ohdr.servicegroup_id != rhdr->servicegroup_id)
+			continue;
+		if ((ohdr.flags & RPMI_MSG_FLAGS_TYPE) != RPMI_MSG_POSTED_REQUEST ||
+		    ohdr.service_id != rhdr->service_id || ohdr.datalen < key_len)
+			break;
+		if (!rpmi_env_memcmp(omsg->data, (void *)rdata, key_len))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Process index-th request of an in-place batch of count requests using the
+ * dispatch table resolved by the caller. Normal requests take the next P2A
+ * acknowledgement slot which is guaranteed to be available by the caller.
+ */
+static void rpmi_context_process_slot(struct rpmi_context *cntx,
+				      struct rpmi_context_transport *ctrans,
+				      struct rpmi_context_dispatch *dispatch,
+				      rpmi_uint32_t index, rpmi_uint32_t count,
+				      rpmi_uint32_t *ack_count,
+				      rpmi_bool_t *do_doorbell)
+{
+	struct rpmi_message_header rhdr, ahdr;
+	struct rpmi_message *rslot, *aslot;
+	struct rpmi_transport *trans = ctrans->trans;
+
+	rslot = rpmi_transport_peek_slot(trans, RPMI_QUEUE_A2P_REQ, index);
+	if (!rslot)
+		return;
+	rpmi_context_convert_header(trans, &rhdr, &rslot->header);
+
+	if (rpmi_context_is_superseded(cntx, ctrans, dispatch, &rhdr,
+				       rslot->data, index + 1, count, true)) {
+		ctrans->superseded++;
+		return;
+	}
+
+	aslot = NULL;
+	if ((rhdr.flags & RPMI_MSG_FLAGS_TYPE) == RPMI_MSG_NORMAL_REQUEST) {
+		aslot = rpmi_transport_peek_slot(trans, RPMI_QUEUE_P2A_ACK,
+						 *ack_count);
+		if (!aslot)
+			return;
+	}
+
+	/* Posted requests build the response in a scratch slot */
+	if (!rpmi_context_process_msg(cntx, trans, dispatch, &rhdr, rslot->data,
+				      &ahdr, aslot ? aslot->data :
+						     ctrans->ack_msg->data))
+		return;
+
+	rpmi_context_convert_header(trans, &aslot->header, &ahdr);
+	(*ack_count)++;
+	if (rhdr.flags & RPMI_MSG_FLAGS_DOORBELL)
+		*do_doorbell = true;
+}
+
+/*
+ * Process A2P requests directly in the transport queue slots. Only the
+ * message headers are converted to native endianness on the stack whereas
+ * the request data is read from the A2P request slot and the acknowledgement
+ * is built directly in the next free P2A acknowledgement slot. Requests to
+ * high priority service groups are processed first in each batch. The
+ * dispatch table of each request is resolved once while scanning the batch.
+ */
+static rpmi_uint32_t rpmi_context_process_inplace(struct rpmi_context *cntx,
+						  struct rpmi_context_transport *ctrans,
+						  rpmi_uint32_t max_msgs)
+{
+	struct rpmi_context_dispatch *dispatch[LIBRPMI_CONTEXT_MSG_BATCH_COUNT];
+	rpmi_uint32_t i, pass, req_count, ack_count, ack_needed, batch_count;
+	rpmi_uint32_t high_mask, processed = 0;
+	struct rpmi_transport *trans = ctrans->trans;
+	struct rpmi_message_header rhdr;
+	struct rpmi_message *rslot;
+	rpmi_bool_t do_doorbell;
+	enum rpmi_error rc;
+
+	do {
+		req_count = 0;
+		ack_count = 0;
+		ack_needed = 0;
+		high_mask = 0;
+		do_doorbell = false;
+		batch_count = RPMI_MIN(max_msgs - processed,
+				       (rpmi_uint32_t)LIBRPMI_CONTEXT_MSG_BATCH_COUNT);
+		while (req_count < batch_count) {
+			rslot = rpmi_transport_peek_slot(trans, RPMI_QUEUE_A2P_REQ,
+							 req_count);
+			if (!rslot)
+				break;
+			rpmi_context_convert_header(trans, &rhdr, &rslot->header);
+
+			/*
+			 * Normal requests need a free acknowledgement slot
+			 * otherwise leave the request in the A2P request
+			 * queue until the application processor catches up.
+			 */
+			if ((rhdr.flags & RPMI_MSG_FLAGS_TYPE) == RPMI_MSG_NORMAL_REQUEST) {
+				if (!rpmi_transport_peek_slot(trans, RPMI_QUEUE_P2A_ACK,
+							      ack_needed)) {
+					ctrans->ack_stalls++;
+					break;
+				}
+				ack_needed++;
+			}
+
+			dispatch[req_count] = rpmi_context_find_dispatch(cntx,
+							rhdr.servicegroup_id);
+			if (dispatch[req_count] &&
+			    dispatch[req_count]->high_priority)
+				high_mask |= 1U << req_count;
+			req_count++;
+		}
+
+		for (pass = (high_mask) ? 0 : 1; pass < 2; pass++) {
+			for (i = 0; i < req_count; i++) {
+				if (((high_mask >> i) & 1) == pass)
+					continue;
+				rpmi_context_process_slot(cntx, ctrans, dispatch[i],
+							  i, req_count, &ack_count,
+							  &do_doorbell);
+			}
+		}
+
+		/* Publish acknowledgements before releasing request slots */
+		rc = rpmi_transport_commit_slot(trans, RPMI_QUEUE_P2A_ACK, ack_count);
+		if (rc) {
+			DPRINTF("%s: %s: p2a acknowledgement failed (error %d)\n",
+				__func__, cntx->name, rc);
+		}
+
+		rc = rpmi_transport_commit_slot(trans, RPMI_QUEUE_A2P_REQ, req_count);
+		if (rc) {
+			DPRINTF("%s: %s: a2p request release failed (error %d)\n",
+				__func__, cntx->name, rc);
+			break;
+		}
+		processed += req_count;
+
+		/* Single doorbell for all acknowledgements of the batch */
+		if (do_doorbell)
+			rpmi_context_ring_doorbell(cntx, ctrans);
+	} while (req_count && processed < max_msgs);
+
+	return processed;
+}
+
+/*
+ * Process index-th request of a copied batch of count requests using the
+ * dispatch table resolved by the caller
+ */
+static void rpmi_context_process_copied(struct rpmi_context *cntx,
+					struct rpmi_context_transport *ctrans,
+					struct rpmi_context_dispatch *dispatch,
+					rpmi_uint32_t index, rpmi_uint32_t count)
+{
+	struct rpmi_transport *trans = ctrans->trans;
+	struct rpmi_message *rmsg, *amsg;
+
+	rmsg = rpmi_transport_batch_msg(trans, ctrans->req_msg, index);
+	if (rpmi_context_is_superseded(cntx, ctrans, dispatch, &rmsg->header,
+				       rmsg->data, index + 1, count, false)) {
+		ctrans->superseded++;
+		return;
+	}
+
+	amsg = rpmi_context_backlog_msg(ctrans, ctrans->ack_head + ctrans->ack_count);
+	if (!rpmi_context_process_msg(cntx, trans, dispatch, &rmsg->header,
+				      rmsg->data, &amsg->header, amsg->data))
+		return;
+
+	ctrans->ack_count++;
+	if (rmsg->header.flags & RPMI_MSG_FLAGS_DOORBELL)
+		ctrans->ack_doorbell = true;
+}
+
+/*
+ * Process A2P requests by copying batches of messages out of the transport
+ * queue. Acknowledgements are built in the backlog ring and pushed without
+ * waiting for the application processor. Requests are not consumed while
+ * the backlog ring is full. Requests to high priority service groups are
+ * processed first in each batch. The dispatch table of each request is
+ * resolved once per batch.
+ */
+static rpmi_uint32_t rpmi_context_process_copy(struct rpmi_context *cntx,
+					       struct rpmi_context_transport *ctrans,
+					       rpmi_uint32_t max_msgs)
+{
+	struct rpmi_context_dispatch *dispatch[LIBRPMI_CONTEXT_MSG_BATCH_COUNT];
+	rpmi_uint32_t i, pass, req_count, batch_count, high_mask, processed = 0;
+	struct rpmi_transport *trans = ctrans->trans;
+	struct rpmi_message *rmsg;
+
+	while (processed < max_msgs) {
+		if (rpmi_context_flush_acks(cntx, ctrans) ==
+		    LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT) {
+			ctrans->ack_stalls++;
+			break;
+		}
+
+		/* Every request of the batch may need a backlog slot */
+		batch_count = RPMI_MIN(max_msgs - processed,
+				       (rpmi_uint32_t)LIBRPMI_CONTEXT_MSG_BATCH_COUNT);
+		batch_count = RPMI_MIN(batch_count,
+				       LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT - ctrans->ack_count);
+		req_count = rpmi_transport_dequeue_batch(trans, RPMI_QUEUE_A2P_REQ,
+							 ctrans->req_msg, batch_count);
+		if (!req_count)
+			break;
+
+		processed += req_count;
+		high_mask = 0;
+		for (i = 0; i < req_count; i++) {
+			rmsg = rpmi_transport_batch_msg(trans, ctrans->req_msg, i);
+			dispatch[i] = rpmi_context_find_dispatch(cntx,
+						rmsg->header.servicegroup_id);
+			if (dispatch[i] && dispatch[i]->high_priority)
+				high_mask |= 1U << i;
+		}
+
+		for (pass = (high_mask) ? 0 : 1; pass < 2; pass++) {
+			for (i = 0; i < req_count; i++) {
+				if (((high_mask >> i) & 1) == pass)
+					continue;
+				rpmi_context_process_copied(cntx, ctrans, dispatch[i],
+							    i, req_count);
+			}
+		}
+	}
+
+	rpmi_context_flush_acks(cntx, ctrans);
+
+	return processed;
+}
+
+/* Send acknowledgements of completed deferred requests of a transport */
+static void rpmi_context_flush_deferred(struct rpmi_context *cntx,
+					struct rpmi_context_transport *ctrans)
+{
+	struct rpmi_context_deferred *d;
+	rpmi_uint32_t i, done, retry = 0;
+
+	if (!cntx->deferred_done)
+		return;
+
+	done = rpmi_env_atomic_xchg32(&cntx->deferred_done, 0);
+	rpmi_env_barrier_acquire();
+
+	for (i = 0; i < LIBRPMI_CONTEXT_MAX_DEFERRED; i++) {
+		if (!(done & (1U << i)))
+			continue;
+
+		d = &cntx->deferred[i];
+		if (d->trans != ctrans->trans ||
+		    rpmi_transport_enqueue(d->trans, RPMI_QUEUE_P2A_ACK, d->msg)) {
+			retry |= 1U << i;
+			continue;
+		}
+
+		if (d->doorbell)
+			rpmi_context_ring_doorbell(cntx, ctrans);
+
+		d->msg = NULL;
+		d->generation = (d->generation + 1) &
+				LIBRPMI_CONTEXT_DEFERRED_GEN_MASK;
+		rpmi_env_barrier_release();
+		d->trans = NULL;
+	}
+
+	if (retry)
+		rpmi_env_atomic_or32(&cntx->deferred_done, retry);
+}
+
+static rpmi_uint32_t rpmi_context_process_transport(struct rpmi_context *cntx,
+						    struct rpmi_context_transport *ctrans,
+						    rpmi_uint32_t max_msgs)
+{
+	rpmi_context_flush_deferred(cntx, ctrans);
+
+	if (rpmi_transport_can_peek(ctrans->trans))
+		return rpmi_context_process_inplace(cntx, ctrans, max_msgs);
+
+	return rpmi_context_process_copy(cntx, ctrans, max_msgs);
+}
+
+void rpmi_context_process_a2p_request(struct rpmi_context *cntx)
+{
+	rpmi_uint32_t i;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	for (i = 0; i < cntx->num_transports; i++)
+		rpmi_context_process_transport(cntx, &cntx->transports[i],
+					       (rpmi_uint32_t)-1);
+}
+
+enum rpmi_error rpmi_context_process_a2p_request_budget(struct rpmi_context *cntx,
+						       rpmi_uint32_t max_msgs,
+						       rpmi_uint32_t *processed)
+{
+	rpmi_uint32_t i, idx, count = 0;
+
+	if (!cntx || !max_msgs) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	/* Share the budget across transports starting from a rotating one */
+	for (i = 0; i < cntx->num_transports && count < max_msgs; i++) {
+		idx = cntx->poll_index + i;
+		if (idx >= cntx->num_transports)
+			idx -= cntx->num_transports;
+		count += rpmi_context_process_transport(cntx, &cntx->transports[idx],
+							max_msgs - count);
+	}
+
+	cntx->poll_index++;
+	if (cntx->poll_index >= cntx->num_transports)
+		cntx->poll_index = 0;
+
+	if (processed)
+		*processed = count;
+
+	return RPMI_SUCCESS;
+}
+
+rpmi_uint32_t rpmi_context_poll(struct rpmi_context *cntx, rpmi_uint32_t budget)
+{
+	rpmi_uint32_t i, idx, processed = 0;
+
+	if (!cntx || !budget) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return 0;
+	}
+
+	/*
+	 * Visit every transport once with the same budget and rotate the
+	 * starting transport so that no transport is always served first.
+	 */
+	for (i = 0; i < cntx->num_transports; i++) {
+		idx = cntx->poll_index + i;
+		if (idx >= cntx->num_transports)
+			idx -= cntx->num_transports;
+		processed += rpmi_context_process_transport(cntx,
+						&cntx->transports[idx], budget);
+	}
+
+	cntx->poll_index++;
+	if (cntx->poll_index >= cntx->num_transports)
+		cntx->poll_index = 0;
+
+	return processed;
+}
+
+void rpmi_context_process_group_events(struct rpmi_context *cntx,
+				       rpmi_uint16_t servicegroup_id)
+{
+	struct rpmi_context_dispatch *dispatch;
+	struct rpmi_service_group *group;
+	enum rpmi_error rc;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	dispatch = rpmi_context_find_dispatch(cntx, servicegroup_id);
+	if (!dispatch) {
+		DPRINTF("%s: %s: group not found for servicegroup_id 0x%x\n",
+			__func__, cntx->name, servicegroup_id);
+		return;
+	}
+	group = dispatch->group;
+	if (!group->process_events) {
+		DPRINTF("%s: %s: group %s does not support events\n",
+			__func__, cntx->name, group->name);
+		return;
+	}
+
+	rpmi_env_atomic_xchg32(&dispatch->events_pending, 0);
+	rpmi_env_lock(group->lock);
+	rc = group->process_events(group);
+	rpmi_env_unlock(group->lock);
+	if (rc == RPMI_ERR_BUSY)
+		rpmi_env_atomic_or32(&dispatch->events_pending, 1);
+	else if (rc) {
+		DPRINTF("%s: %s: group %s failed with error %d\n",
+			__func__, cntx->name, group->name, rc);
+	}
+}
+
+void rpmi_context_process_all_events(struct rpmi_context *cntx)
+{
+	struct rpmi_context_dispatch *dispatch;
+	struct rpmi_service_group *group;
+	rpmi_bool_t do_sweep = false;
+	enum rpmi_error rc;
+	rpmi_uint32_t i;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	rpmi_env_lock(cntx->groups_lock);
+
+	/* Groups which can only poll are handled by the periodic sweep */
+	if (cntx->event_sweep_period) {
+		cntx->event_sweep_count++;
+		if (cntx->event_sweep_count >= cntx->event_sweep_period) {
+			cntx->event_sweep_count = 0;
+			do_sweep = true;
+		}
+	}
+
+	for (i = 0; i < cntx->num_groups; i++) {
+		group = cntx->groups[i];
+		dispatch = cntx->dispatch[i];
+		if (!group->process_events)
+			continue;
+		if (!rpmi_env_atomic_xchg32(&dispatch->events_pending, 0) &&
+		    !do_sweep)
+			continue;
+
+		rpmi_env_unlock(cntx->groups_lock);
+
+		rpmi_env_lock(group->lock);
+		rc = group->process_events(group);
+		rpmi_env_unlock(group->lock);
+		if (rc == RPMI_ERR_BUSY) {
+			/* Retry in the next call */
+			rpmi_env_atomic_or32(&dispatch->events_pending, 1);
+		} else if (rc) {
+			DPRINTF("%s: %s: group %s failed with error %d\n",
+				__func__, cntx->name, group->name, rc);
+		}
+
+		rpmi_env_lock(cntx->groups_lock);
+	}
+
+	rpmi_env_unlock(cntx->groups_lock);
+
+	/* Events processed above may have queued notifications */
+	rpmi_context_flush_notifications(cntx);
+}
+
+enum rpmi_error rpmi_context_queue_notification(struct rpmi_context *cntx,
+						rpmi_uint16_t servicegroup_id,
+						rpmi_uint8_t event_id,
+						const rpmi_uint32_t *data,
+						rpmi_uint32_t num_words)
+{
+	struct rpmi_context_dispatch *dispatch;
+	struct rpmi_context_notify *notify;
+	enum rpmi_error rc = RPMI_SUCCESS;
+	rpmi_bool_t queued = false;
+	rpmi_uint32_t i, bit;
+
+	if (!cntx || (num_words && !data)) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	dispatch = rpmi_context_find_dispatch(cntx, servicegroup_id);
+	if (!dispatch) {
+		DPRINTF("%s: %s: group not found for servicegroup_id 0x%x\n",
+			__func__, cntx->name, servicegroup_id);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	bit = (event_id < 32) ? (1U << event_id) : 0;
+	if (!(dispatch->group->notification_events & bit))
+		return RPMI_ERR_NOTSUPP;
+
+	rpmi_env_lock(cntx->notify_lock);
+
+	/*
+	 * The event is queued for every transport which enabled it or for
+	 * none of them so that the caller can retry upon RPMI_ERR_BUSY
+	 */
+	for (i = 0; i < cntx->num_transports; i++) {
+		notify = &dispatch->notify[i];
+		if ((notify->enabled & bit) &&
+		    dispatch->notify_max_words - notify->words < num_words + 1) {
+			DPRINTF("%s: %s: group %s notification buffer full\n",
+				__func__, cntx->name, dispatch->group->name);
+			rc = RPMI_ERR_BUSY;
+			goto done;
+		}
+	}
+
+	/* Events not enabled by the application processor are dropped */
+	for (i = 0; i < cntx->num_transports; i++) {
+		notify = &dispatch->notify[i];
+		if (!(notify->enabled & bit))
+			continue;
+
+		notify->buf[notify->words++] =
+			RPMI_NOTIF_EVENT_HDR(event_id,
+					     num_words * sizeof(rpmi_uint32_t));
+		rpmi_env_memcpy(&notify->buf[notify->words], data,
+				num_words * sizeof(rpmi_uint32_t));
+		notify->words += num_words;
+		queued = true;
+	}
+
+done:
+	rpmi_env_unlock(cntx->notify_lock);
+
+	if (queued) {
+		rpmi_env_atomic_or32(&cntx->notify_pending, 1);
+		rpmi_context_signal(cntx, LIBRPMI_CONTEXT_SIGNAL_EVENTS);
+	}
+
+	return rc;
+}
+
+void rpmi_context_flush_notifications(struct rpmi_context *cntx)
+{
+	struct rpmi_context_dispatch *dispatch;
+	struct rpmi_context_notify *notify;
+	struct rpmi_message *msg;
+	struct rpmi_transport *trans;
+	rpmi_uint32_t i, j, t, sent = 0;
+	rpmi_bool_t retry = false;
+	rpmi_uint32_t *data;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	if (!rpmi_env_atomic_xchg32(&cntx->notify_pending, 0))
+		return;
+
+	msg = cntx->notify_msg;
+	data = (void *)msg->data;
+
+	rpmi_env_lock(cntx->groups_lock);
+	rpmi_env_lock(cntx->notify_lock);
+
+	/* Queued events of a service group for a transport go in one message */
+	for (i = 0; i < cntx->num_groups; i++) {
+		dispatch = cntx->dispatch[i];
+		for (t = 0; t < cntx->num_transports; t++) {
+			notify = &dispatch->notify[t];
+			if (!notify->words)
+				continue;
+
+			trans = cntx->transports[t].trans;
+			msg->header.servicegroup_id =
+					dispatch->group->servicegroup_id;
+			msg->header.service_id = 0;
+			msg->header.flags = RPMI_MSG_NOTIFICATION;
+			msg->header.datalen = notify->words * sizeof(rpmi_uint32_t);
+			msg->header.token = cntx->notify_token;
+			for (j = 0; j < notify->words; j++)
+				data[j] = rpmi_to_xe32(trans->is_be, notify->buf[j]);
+
+			/* Retry in the next call when P2A request queue is full */
+			if (rpmi_transport_enqueue(trans, RPMI_QUEUE_P2A_REQ, msg)) {
+				retry = true;
+				continue;
+			}
+
+			cntx->notify_token++;
+			notify->words = 0;
+			sent |= 1U << t;
+		}
+	}
+
+	rpmi_env_unlock(cntx->notify_lock);
+	rpmi_env_unlock(cntx->groups_lock);
+
+	if (retry)
+		rpmi_env_atomic_or32(&cntx->notify_pending, 1);
+
+	/* One doorbell per transport for all its notification messages */
+	for (i = 0; i < cntx->num_transports; i++) {
+		if (sent & (1U << i))
+			rpmi_context_ring_doorbell(cntx, &cntx->transports[i]);
+	}
+}
+
+enum rpmi_error rpmi_context_mark_group_pending(struct rpmi_context *cntx,
+						rpmi_uint16_t servicegroup_id)
+{
+	struct rpmi_context_dispatch *dispatch;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	dispatch = rpmi_context_find_dispatch(cntx, servicegroup_id);
+	if (!dispatch) {
+		DPRINTF("%s: %s: group not found for servicegroup_id 0x%x\n",
+			__func__, cntx->name, servicegroup_id);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	rpmi_env_atomic_or32(&dispatch->events_pending, 1);
+	rpmi_context_signal(cntx, LIBRPMI_CONTEXT_SIGNAL_EVENTS);
+
+	return RPMI_SUCCESS;
+}
+
+void rpmi_context_set_event_sweep_period(struct rpmi_context *cntx,
+					 rpmi_uint32_t period)
+{
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	rpmi_env_lock(cntx->groups_lock);
+	cntx->event_sweep_period = period;
+	cntx->event_sweep_count = 0;
+	rpmi_env_unlock(cntx->groups_lock);
+}
+
+void rpmi_context_signal(struct rpmi_context *cntx, rpmi_uint32_t sources)
+{
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	rpmi_env_atomic_or32(&cntx->signalled, sources);
+	rpmi_env_signal_event(cntx->event);
+}
+
+/*
+ * Signal sources with work left behind by a full P2A queue (requests held
+ * back, acknowledgements in the backlog ring, deferred completions and
+ * notifications) or by service groups which returned RPMI_ERR_BUSY.
+ */
+static rpmi_uint32_t rpmi_context_work_left(struct rpmi_context *cntx)
+{
+	struct rpmi_context_transport *ctrans;
+	rpmi_uint32_t i, left = 0;
+
+	if (cntx->deferred_done)
+		left |= LIBRPMI_CONTEXT_SIGNAL_A2P;
+	for (i = 0; i < cntx->num_transports; i++) {
+		ctrans = &cntx->transports[i];
+		if (ctrans->ack_count ||
+		    !rpmi_transport_is_empty(ctrans->trans, RPMI_QUEUE_A2P_REQ))
+			left |= LIBRPMI_CONTEXT_SIGNAL_A2P;
+	}
+
+	if (cntx->notify_pending)
+		left |= LIBRPMI_CONTEXT_SIGNAL_EVENTS;
+	rpmi_env_lock(cntx->groups_lock);
+	for (i = 0; i < cntx->num_groups; i++) {
+		if (cntx->dispatch[i]->events_pending)
+			left |= LIBRPMI_CONTEXT_SIGNAL_EVENTS;
+	}
+	rpmi_env_unlock(cntx->groups_lock);
+
+	return left;
+}
+
+rpmi_uint32_t rpmi_context_process_signalled(struct rpmi_context *cntx)
+{
+	rpmi_uint32_t sources, left;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return 0;
+	}
+
+	sources = rpmi_env_atomic_xchg32(&cntx->signalled, 0);
+	if (sources & LIBRPMI_CONTEXT_SIGNAL_A2P)
+		rpmi_context_process_a2p_request(cntx);
+	if (sources & LIBRPMI_CONTEXT_SIGNAL_EVENTS)
+		rpmi_context_process_all_events(cntx);
+
+	/* Nobody signals again when the application processor drains a queue */
+	left = rpmi_context_work_left(cntx);
+	if (left)
+		rpmi_env_atomic_or32(&cntx->signalled, left);
+
+	return left | (sources & LIBRPMI_CONTEXT_SIGNAL_STOP);
+}
+
+void rpmi_context_run(struct rpmi_context *cntx)
+{
+	rpmi_uint32_t left;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	while (1) {
+		/* Without wait/notify support all sources are polled */
+		if (!cntx->event)
+			rpmi_env_atomic_or32(&cntx->signalled,
+					     LIBRPMI_CONTEXT_SIGNAL_A2P |
+					     LIBRPMI_CONTEXT_SIGNAL_EVENTS);
+
+		left = rpmi_context_process_signalled(cntx);
+		if (left & LIBRPMI_CONTEXT_SIGNAL_STOP)
+			break;
+
+		/*
+		 * Sources signalled while processing make this return at once.
+		 * Work left is retried and service groups which can only poll
+		 * are swept after a bounded wait.
+		 */
+		if (left) {
+			rpmi_env_wait_event_timeout(cntx->event,
+						    LIBRPMI_CONTEXT_RUN_TIMEOUT_US);
+		} else if (cntx->event && cntx->event_sweep_period) {
+			/* Next call after an idle timeout sweeps all groups */
+			rpmi_env_lock(cntx->groups_lock);
+			if (cntx->event_sweep_period)
+				cntx->event_sweep_count = cntx->event_sweep_period - 1;
+			rpmi_env_unlock(cntx->groups_lock);
+			rpmi_env_atomic_or32(&cntx->signalled,
+					     LIBRPMI_CONTEXT_SIGNAL_EVENTS);
+			rpmi_env_wait_event_timeout(cntx->event,
+						    LIBRPMI_CONTEXT_RUN_TIMEOUT_US);
+		} else {
+			rpmi_env_wait_event(cntx->event);
+		}
+	}
+}
+
+struct rpmi_service_group *rpmi_context_find_group(struct rpmi_context *cntx,
+						   rpmi_uint16_t servicegroup_id)
+{
+	struct rpmi_context_dispatch *dispatch;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return NULL;
+	}
+
+	dispatch = rpmi_context_find_dispatch(cntx, servicegroup_id);
+
+	return (dispatch) ? dispatch->group : NULL;
+}
+
+static enum rpmi_error rpmi_context_verify_privilege_level(struct rpmi_context *cntx,
+						      struct rpmi_service_group *group)
+{
+	if (!group->privilege_level_bitmap)
+		return RPMI_ERR_INVALID_PARAM;
+
+	if (group->privilege_level_bitmap & (1U << cntx->privilege_level))
+		return RPMI_SUCCESS;
+
+	return RPMI_ERR_DENIED;
+}
+
+/*
+ * Attach service groups which wake up or mark themselves pending in the
+ * RPMI context (or detach if attach_cntx is NULL)
+ */
+static void rpmi_context_attach_group(struct rpmi_context *cntx,
+				      struct rpmi_service_group *group,
+				      struct rpmi_context *attach_cntx)
+{
+	switch (group->servicegroup_id) {
+	case RPMI_SRVGRP_SYSTEM_MSI:
+		cntx->sysmsi_group = (attach_cntx) ? group : NULL;
+		rpmi_service_group_sysmsi_set_context(group, attach_cntx);
+		break;
+	case RPMI_SRVGRP_HSM:
+		rpmi_service_group_hsm_set_context(group, attach_cntx);
+		break;
+	case RPMI_SRVGRP_CPPC:
+		rpmi_service_group_cppc_set_context(group, attach_cntx);
+		break;
+	case RPMI_SRVGRP_SYSTEM_SUSPEND:
+		rpmi_service_group_syssusp_set_context(group, attach_cntx);
+		break;
+	case RPMI_SRVGRP_PERFORMANCE:
+		rpmi_service_group_perf_set_context(group, attach_cntx);
+		break;
+	default:
+		break;
+	}
+}
+
+enum rpmi_error rpmi_context_add_group(struct rpmi_context *cntx,
+				       struct rpmi_service_group *group)
+{
+	struct rpmi_context_dispatch *dispatch, **slot;
+	enum rpmi_error rc = RPMI_SUCCESS;
+	rpmi_uint32_t i;
+
+	if (!cntx || !group) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	rpmi_env_lock(cntx->groups_lock);
+
+	if (cntx->max_num_groups <= cntx->num_groups) {
+		DPRINTF("%s: %s: no space to add group %s\n",
+			__func__, cntx->name, group->name);
+		rc = RPMI_ERR_IO;
+		goto fail_unlock;
+	}
+
+	for (i = 0; i < cntx->num_groups; i++) {
+		if (cntx->groups[i] == group ||
+		    cntx->groups[i]->servicegroup_id == group->servicegroup_id) {
+			DPRINTF("%s: %s: group %s alread added\n",
+				__func__, cntx->name, group->name);
+			rc = RPMI_ERR_ALREADY;
+			goto fail_unlock;
 		}
 	}
 
@@ -551,11 +1874,28 @@ enum rpmi_error rpmi_context_add_group(struct rpmi_context *cntx,
 	if (rc)
 		goto fail_unlock;
 
+	dispatch = rpmi_context_dispatch_create(cntx, group);
+	if (!dispatch) {
+		DPRINTF("%s: %s: failed to create dispatch table for group %s\n",
+			__func__, cntx->name, group->name);
+		rc = RPMI_ERR_FAILED;
+		goto fail_unlock;
+	}
+
 	cntx->groups[cntx->num_groups] = group;
+	cntx->dispatch[cntx->num_groups] = dispatch;
 	cntx->num_groups++;
+	if (group->notification_events)
+		cntx->num_notify_groups++;
+
+	/* Dispatch table must be fully visible before it is published */
+	slot = rpmi_context_dispatch_slot(cntx, group->servicegroup_id);
+	if (slot) {
+		rpmi_env_barrier_release();
+		*slot = dispatch;
+	}
 
-	if (group->servicegroup_id == RPMI_SRVGRP_SYSTEM_MSI)
-		cntx->sysmsi_group = group;
+	rpmi_context_attach_group(cntx, group, cntx);
 
 fail_unlock:
 	rpmi_env_unlock(cntx->groups_lock);
@@ -566,6 +1906,7 @@ fail_unlock:
 void rpmi_context_remove_group(struct rpmi_context *cntx,
 			       struct rpmi_service_group *group)
 {
+	struct rpmi_context_dispatch **slot;
 	rpmi_uint32_t i, j;
 
 	if (!cntx || !group) {
@@ -579,13 +1920,23 @@ void rpmi_context_remove_group(struct rpmi_context *cntx,
 		if (cntx->groups[i] != group)
 			continue;
 
-		for (j = i; j < (cntx->num_groups - 1); j++)
+		slot = rpmi_context_dispatch_slot(cntx, group->servicegroup_id);
+		if (slot)
+			*slot = NULL;
+		if (group->notification_events)
+			cntx->num_notify_groups--;
+		cntx->dispatch[i]->retired_next = cntx->retired;
+		cntx->retired = cntx->dispatch[i];
+
+		for (j = i; j < (cntx->num_groups - 1); j++) {
 			cntx->groups[j] = cntx->groups[j + 1];
+			cntx->dispatch[j] = cntx->dispatch[j + 1];
+		}
 
 		cntx->num_groups--;
 		cntx->groups[cntx->num_groups] = NULL;
-		if (group->servicegroup_id == RPMI_SRVGRP_SYSTEM_MSI)
-			cntx->sysmsi_group = NULL;
+		cntx->dispatch[cntx->num_groups] = NULL;
+		rpmi_context_attach_group(cntx, group, NULL);
 
 		break;
 	}
@@ -593,6 +1944,361 @@ void rpmi_context_remove_group(struct rpmi_context *cntx,
 	rpmi_env_unlock(cntx->groups_lock);
 }
 
+static enum rpmi_error rpmi_context_transport_init(struct rpmi_context_transport *ctrans,
+						   struct rpmi_transport *trans)
+{
+#ifdef LIBRPMI_LE_ONLY
+	/* Endian conversions assume little-endian transports */
+	if (trans->is_be)
+		return RPMI_ERR_NOTSUPP;
+#endif
+
+	ctrans->req_msg = rpmi_env_zalloc(LIBRPMI_CONTEXT_MSG_BATCH_COUNT *
+					  trans->slot_size);
+	if (!ctrans->req_msg)
+		return RPMI_ERR_FAILED;
+
+	ctrans->ack_msg = rpmi_env_zalloc(LIBRPMI_CONTEXT_ACK_BACKLOG_COUNT *
+					  trans->slot_size);
+	if (!ctrans->ack_msg)
+		goto fail_free_req;
+
+	ctrans->deferred_msg = rpmi_env_zalloc(LIBRPMI_CONTEXT_MAX_DEFERRED *
+					       trans->slot_size);
+	if (!ctrans->deferred_msg)
+		goto fail_free_ack;
+
+	ctrans->trans = trans;
+	return RPMI_SUCCESS;
+
+fail_free_ack:
+	rpmi_env_free(ctrans->ack_msg);
+	ctrans->ack_msg = NULL;
+fail_free_req:
+	rpmi_env_free(ctrans->req_msg);
+	ctrans->req_msg = NULL;
+	return RPMI_ERR_FAILED;
+}
+
+static void rpmi_context_transport_cleanup(struct rpmi_context_transport *ctrans)
+{
+	rpmi_env_free(ctrans->deferred_msg);
+	rpmi_env_free(ctrans->ack_msg);
+	rpmi_env_free(ctrans->req_msg);
+	rpmi_env_memset(ctrans, 0, sizeof(*ctrans));
+}
+
+enum rpmi_error rpmi_context_add_transport(struct rpmi_context *cntx,
+					   struct rpmi_transport *trans,
+					   rpmi_uint32_t p2a_msi_index)
+{
+	enum rpmi_error rc;
+	rpmi_uint32_t i;
+
+	if (!cntx || !trans) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	/* Base group responses are sized for the primary transport */
+	if (trans->slot_size < cntx->trans->slot_size) {
+		DPRINTF("%s: %s: transport %s slot size too small\n",
+			__func__, cntx->name, trans->name);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	if (cntx->num_transports >= LIBRPMI_CONTEXT_MAX_TRANSPORTS) {
+		DPRINTF("%s: %s: no space to add transport %s\n",
+			__func__, cntx->name, trans->name);
+		return RPMI_ERR_IO;
+	}
+
+	for (i = 0; i < cntx->num_transports; i++) {
+		if (cntx->transports[i].trans == trans) {
+			DPRINTF("%s: %s: transport %s already added\n",
+				__func__, cntx->name, trans->name);
+			return RPMI_ERR_ALREADY;
+		}
+	}
+
+	rc = rpmi_context_transport_init(&cntx->transports[cntx->num_transports],
+					 trans);
+	if (rc) {
+		DPRINTF("%s: %s: transport %s buffer allocation failed\n",
+			__func__, cntx->name, trans->name);
+		return rc;
+	}
+	cntx->transports[cntx->num_transports].p2a_msi_index = p2a_msi_index;
+	cntx->num_transports++;
+
+	return RPMI_SUCCESS;
+}
+
+/*
+ * Disable notifications enabled through a transport which is going away and
+ * move the notification state of later transports down with their slots
+ */
+static void rpmi_context_drop_notifications(struct rpmi_context *cntx,
+					    rpmi_uint32_t index)
+{
+	struct rpmi_context_dispatch *dispatch;
+	rpmi_uint32_t i, j, *buf;
+
+	rpmi_env_lock(cntx->groups_lock);
+	rpmi_env_lock(cntx->notify_lock);
+
+	for (i = 0; i < cntx->num_groups; i++) {
+		dispatch = cntx->dispatch[i];
+		buf = dispatch->notify[index].buf;
+		for (j = index; j < (cntx->num_transports - 1); j++)
+			dispatch->notify[j] = dispatch->notify[j + 1];
+
+		dispatch->notify[j].enabled = 0;
+		dispatch->notify[j].buf = buf;
+		dispatch->notify[j].words = 0;
+	}
+
+	rpmi_env_unlock(cntx->notify_lock);
+	rpmi_env_unlock(cntx->groups_lock);
+}
+
+/* Forget deferred requests of a transport which is going away */
+static void rpmi_context_drop_deferred(struct rpmi_context *cntx,
+				       struct rpmi_transport *trans)
+{
+	struct rpmi_context_deferred *d;
+	rpmi_uint32_t i;
+
+	for (i = 0; i < LIBRPMI_CONTEXT_MAX_DEFERRED; i++) {
+		d = &cntx->deferred[i];
+		if (d->trans != trans)
+			continue;
+
+		d->msg = NULL;
+		d->generation = (d->generation + 1) &
+				LIBRPMI_CONTEXT_DEFERRED_GEN_MASK;
+		d->trans = NULL;
+		/* Completions of other entries may set bits concurrently */
+		rpmi_env_atomic_and32(&cntx->deferred_done, ~(1U << i));
+	}
+}
+
+enum rpmi_error rpmi_context_defer_request(struct rpmi_context *cntx,
+					   rpmi_uint32_t *token)
+{
+	struct rpmi_context_transport *ctrans = NULL;
+	const struct rpmi_message_header *rhdr;
+	struct rpmi_context_deferred *d = NULL;
+	rpmi_uint32_t i;
+
+	if (!cntx || !token) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	rhdr = cntx->cur_hdr;
+	if (!rhdr || cntx->cur_deferred) {
+		DPRINTF("%s: %s: no request being processed\n",
+			__func__, cntx->name);
+		return RPMI_ERR_INVALID_STATE;
+	}
+
+	/* Posted requests are never acknowledged */
+	if ((rhdr->flags & RPMI_MSG_FLAGS_TYPE) != RPMI_MSG_NORMAL_REQUEST)
+		return RPMI_ERR_NOTSUPP;
+
+	for (i = 0; i < cntx->num_transports; i++) {
+		if (cntx->transports[i].trans == cntx->cur_trans) {
+			ctrans = &cntx->transports[i];
+			break;
+		}
+	}
+	if (!ctrans)
+		return RPMI_ERR_FAILED;
+
+	for (i = 0; i < LIBRPMI_CONTEXT_MAX_DEFERRED; i++) {
+		if (!cntx->deferred[i].trans) {
+			d = &cntx->deferred[i];
+			break;
+		}
+	}
+	if (!d) {
+		DPRINTF("%s: %s: too many deferred requests\n",
+			__func__, cntx->name);
+		return RPMI_ERR_BUSY;
+	}
+
+	/* Acknowledgement slot preallocated for the entry on the transport */
+	d->msg = rpmi_transport_batch_msg(ctrans->trans, ctrans->deferred_msg, i);
+	rpmi_env_memset(&d->msg->header, 0, sizeof(d->msg->header));
+	d->msg->header.flags = RPMI_MSG_ACKNOWLEDGEMENT;
+	d->msg->header.service_id = rhdr->service_id;
+	d->msg->header.servicegroup_id = rhdr->servicegroup_id;
+	d->msg->header.token = rhdr->token;
+	d->doorbell = (rhdr->flags & RPMI_MSG_FLAGS_DOORBELL) ? true : false;
+	d->trans = cntx->cur_trans;
+	cntx->cur_deferred = true;
+
+	*token = LIBRPMI_CONTEXT_DEFERRED_TOKEN(d->generation, i);
+	return RPMI_SUCCESS;
+}
+
+enum rpmi_error rpmi_context_complete_request(struct rpmi_context *cntx,
+					      rpmi_uint32_t token,
+					      const void *data,
+					      rpmi_uint16_t datalen)
+{
+	rpmi_uint32_t i = LIBRPMI_CONTEXT_DEFERRED_TOKEN_INDEX(token);
+	struct rpmi_context_deferred *d;
+
+	if (!cntx || (datalen && !data) || i >= LIBRPMI_CONTEXT_MAX_DEFERRED) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	d = &cntx->deferred[i];
+	if (!d->trans ||
+	    d->generation != LIBRPMI_CONTEXT_DEFERRED_TOKEN_GEN(token) ||
+	    (cntx->deferred_done & (1U << i))) {
+		DPRINTF("%s: %s: stale token 0x%x\n", __func__, cntx->name, token);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	if (datalen > (d->trans->slot_size - sizeof(struct rpmi_message_header))) {
+		DPRINTF("%s: %s: response too long (%d bytes)\n",
+			__func__, cntx->name, datalen);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	rpmi_env_memcpy(d->msg->data, data, datalen);
+	d->msg->header.datalen = datalen;
+
+	/* Response must be visible before the entry is seen as completed */
+	rpmi_env_barrier_release();
+	rpmi_env_atomic_or32(&cntx->deferred_done, 1U << i);
+	rpmi_context_signal(cntx, LIBRPMI_CONTEXT_SIGNAL_A2P);
+
+	return RPMI_SUCCESS;
+}
+
+void rpmi_context_set_deferred_generation(struct rpmi_context *cntx,
+					  rpmi_uint32_t generation)
+{
+	rpmi_uint32_t i;
+
+	for (i = 0; i < LIBRPMI_CONTEXT_MAX_DEFERRED; i++) {
+		if (!cntx->deferred[i].trans)
+			cntx->deferred[i].generation =
+				generation & LIBRPMI_CONTEXT_DEFERRED_GEN_MASK;
+	}
+}
+
+void rpmi_context_remove_transport(struct rpmi_context *cntx,
+				   struct rpmi_transport *trans)
+{
+	rpmi_uint32_t i, j;
+
+	if (!cntx || !trans) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	/* Primary transport stays with the context until it is destroyed */
+	for (i = 1; i < cntx->num_transports; i++) {
+		if (cntx->transports[i].trans != trans)
+			continue;
+
+		rpmi_context_transport_cleanup(&cntx->transports[i]);
+		rpmi_context_drop_deferred(cntx, trans);
+		rpmi_context_drop_notifications(cntx, i);
+		for (j = i; j < (cntx->num_transports - 1); j++)
+			cntx->transports[j] = cntx->transports[j + 1];
+
+		cntx->num_transports--;
+		rpmi_env_memset(&cntx->transports[cntx->num_transports], 0,
+				sizeof(cntx->transports[0]));
+		if (cntx->poll_index >= cntx->num_transports)
+			cntx->poll_index = 0;
+
+		break;
+	}
+}
+
+rpmi_uint64_t rpmi_context_ack_stall_count(struct rpmi_context *cntx)
+{
+	rpmi_uint64_t ret = 0;
+	rpmi_uint32_t i;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return 0;
+	}
+
+	for (i = 0; i < cntx->num_transports; i++)
+		ret += cntx->transports[i].ack_stalls;
+
+	return ret;
+}
+
+enum rpmi_error rpmi_context_get_stats(struct rpmi_context *cntx,
+				       rpmi_uint16_t servicegroup_id,
+				       rpmi_uint8_t service_id,
+				       struct rpmi_service_stats *stats)
+{
+#ifdef LIBRPMI_STATS
+	struct rpmi_context_dispatch *dispatch;
+
+	if (!cntx || !stats) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	dispatch = rpmi_context_find_dispatch(cntx, servicegroup_id);
+	if (!dispatch) {
+		DPRINTF("%s: %s: service group ID 0x%x not found\n",
+			__func__, cntx->name, servicegroup_id);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	rpmi_env_lock(dispatch->lock);
+	if (service_id < dispatch->num_services)
+		*stats = dispatch->entries[service_id].stats;
+	else
+		*stats = dispatch->invalid_entry.stats;
+	rpmi_env_unlock(dispatch->lock);
+
+	return RPMI_SUCCESS;
+#else
+	return RPMI_ERR_NOTSUPP;
+#endif
+}
+
+void rpmi_context_set_coalescing(struct rpmi_context *cntx, rpmi_bool_t enable)
+{
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	cntx->coalesce = enable;
+}
+
+rpmi_uint64_t rpmi_context_superseded_count(struct rpmi_context *cntx)
+{
+	rpmi_uint64_t ret = 0;
+	rpmi_uint32_t i;
+
+	if (!cntx) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return 0;
+	}
+
+	for (i = 0; i < cntx->num_transports; i++)
+		ret += cntx->transports[i].superseded;
+
+	return ret;
+}
+
 struct rpmi_context *rpmi_context_create(const char *name,
 					 struct rpmi_transport *trans,
 					 rpmi_uint32_t max_num_groups,
@@ -624,6 +2330,7 @@ struct rpmi_context *rpmi_context_create(const char *name,
 	cntx->trans = trans;
 	cntx->max_num_groups = max_num_groups;
 	cntx->privilege_level = privilege_level;
+	cntx->event_sweep_period = LIBRPMI_CONTEXT_EVENT_SWEEP_PERIOD;
 
 	/**
 	 * Allocate for the array of pointers to the service
@@ -635,24 +2342,35 @@ struct rpmi_context *rpmi_context_create(const char *name,
 		goto fail_free_cntx;
 	}
 
+	cntx->dispatch = rpmi_env_zalloc(cntx->max_num_groups * sizeof(*cntx->dispatch));
+	if (!cntx->dispatch) {
+		DPRINTF("%s: %s: dispatch array allocation failed\n", __func__, name);
+		goto fail_free_groups_array;
+	}
+
 	cntx->groups_lock = rpmi_env_alloc_lock();
+	cntx->notify_lock = rpmi_env_alloc_lock();
+	cntx->event = rpmi_env_alloc_event();
 
-	cntx->req_msg = rpmi_env_zalloc(trans->slot_size);
-	if (!cntx->req_msg) {
-		DPRINTF("%s: %s: request message allocation failed\n", __func__, name);
+	cntx->notify_msg = rpmi_env_zalloc(trans->slot_size);
+	if (!cntx->notify_msg) {
+		DPRINTF("%s: %s: notification buffer allocation failed\n",
+			__func__, name);
 		goto fail_free_groups;
 	}
 
-	cntx->ack_msg = rpmi_env_zalloc(trans->slot_size);
-	if (!cntx->ack_msg) {
-		DPRINTF("%s: %s: acknowledgement message allocation failed\n", __func__, name);
-		goto fail_free_req_msg;
+	rc = rpmi_context_transport_init(&cntx->transports[0], trans);
+	if (rc) {
+		DPRINTF("%s: %s: transport init failed (error %d)\n",
+			__func__, name, rc);
+		goto fail_free_groups;
 	}
+	cntx->num_transports = 1;
 
 	cntx->base_group = rpmi_base_group_create(cntx, plat_info_len, plat_info);
 	if (!cntx->base_group) {
 		DPRINTF("%s: %s: base group creation failed\n", __func__, name);
-		goto fail_free_ack_msg;
+		goto fail_cleanup_transport;
 	}
 
 	rc = rpmi_context_add_group(cntx, cntx->base_group);
@@ -665,12 +2383,15 @@ struct rpmi_context *rpmi_context_create(const char *name,
 
 fail_destroy_base:
 	rpmi_base_group_destroy(cntx->base_group);
-fail_free_ack_msg:
-	rpmi_env_free(cntx->ack_msg);
-fail_free_req_msg:
-	rpmi_env_free(cntx->req_msg);
+fail_cleanup_transport:
+	rpmi_context_transport_cleanup(&cntx->transports[0]);
 fail_free_groups:
+	rpmi_env_free(cntx->notify_msg);
+	rpmi_env_free_event(cntx->event);
+	rpmi_env_free_lock(cntx->notify_lock);
 	rpmi_env_free_lock(cntx->groups_lock);
+	rpmi_env_free(cntx->dispatch);
+fail_free_groups_array:
 	rpmi_env_free(cntx->groups);
 fail_free_cntx:
 	rpmi_env_free(cntx);
@@ -679,6 +2400,9 @@ fail_free_cntx:
 
 void rpmi_context_destroy(struct rpmi_context *cntx)
 {
+	struct rpmi_context_dispatch *dispatch;
+	rpmi_uint32_t i;
+
 	if (cntx->num_groups > 1) {
 		DPRINTF("%s: %s: failed to destroy\n", __func__, cntx->name);
 		return;
@@ -687,9 +2411,21 @@ void rpmi_context_destroy(struct rpmi_context *cntx)
 	rpmi_context_remove_group(cntx, cntx->base_group);
 	rpmi_base_group_destroy(cntx->base_group);
 
-	rpmi_env_free(cntx->ack_msg);
-	rpmi_env_free(cntx->req_msg);
+	while (cntx->retired) {
+		dispatch = cntx->retired;
+		cntx->retired = dispatch->retired_next;
+		rpmi_env_free(dispatch);
+	}
+
+	for (i = 0; i < cntx->num_transports; i++) {
+		rpmi_context_drop_deferred(cntx, cntx->transports[i].trans);
+		rpmi_context_transport_cleanup(&cntx->transports[i]);
+	}
+	rpmi_env_free(cntx->notify_msg);
+	rpmi_env_free_event(cntx->event);
+	rpmi_env_free_lock(cntx->notify_lock);
 	rpmi_env_free_lock(cntx->groups_lock);
+	rpmi_env_free(cntx->dispatch);
 	rpmi_env_free(cntx->groups);
 	rpmi_env_free(cntx);
 }
@@ -5,6 +5,7 @@
  */
 
 #include <librpmi.h>
+#include "librpmi_internal.h"
 
 #ifdef LIBRPMI_DEBUG
 #define DPRINTF(msg...)		rpmi_env_printf(msg)
@@ -27,28 +28,49 @@ struct rpmi_hsm_hart {
 	rpmi_uint64_t resume_addr;
 };
 
+/** Entry of the hart ID lookup table */
+struct rpmi_hsm_id_map {
+	rpmi_uint32_t hart_id;
+	rpmi_uint32_t hart_index;
+};
+
 struct rpmi_hsm {
 	/** Whether HSM instance is non-leaf (or hierarchical) instance */
 	rpmi_bool_t is_non_leaf;
 
+	/** RPMI context of the HSM service group (NULL if not added) */
+	struct rpmi_context *cntx;
+
+	/** Platform notifies wakeup of suspended harts (no polling needed) */
+	rpmi_bool_t wakeup_notify;
+
+	/** Number of harts (of all child instances for non-leaf instance) */
+	rpmi_uint32_t hart_count;
+
+	/** Array of hart IDs indexed by hart index */
+	const rpmi_uint32_t *hart_ids;
+
+	/** Hart IDs are consecutive starting from hart_ids[0] */
+	rpmi_bool_t linear_ids;
+
+	/** Hart ID lookup table sorted by hart ID (NULL if linear_ids) */
+	struct rpmi_hsm_id_map *id_map;
+
+	/** Number of suspend types */
+	rpmi_uint32_t suspend_type_count;
+
+	/** Array of suspend types (of first child for non-leaf instance) */
+	const struct rpmi_hsm_suspend_type *suspend_types;
+
+	/** Suspend type lookup table sorted by type value */
+	const struct rpmi_hsm_suspend_type **suspend_type_map;
+
 	union {
 		/** Details required by leaf instance */
 		struct {
-			/** Number of harts */
-			rpmi_uint32_t hart_count;
-
-			/** Array of hart IDs */
-			const rpmi_uint32_t *hart_ids;
-
 			/** Array of harts */
 			struct rpmi_hsm_hart *harts;
 
-			/** Number of suspend types */
-			rpmi_uint32_t suspend_type_count;
-
-			/** Array of suspend types */
-			const struct rpmi_hsm_suspend_type *suspend_types;
-
 			/**
 			 * Platform HSM operations
 			 *
@@ -58,6 +80,12 @@ struct rpmi_hsm {
 
 			/** Private data of platform HSM operations */
 			void *ops_priv;
+
+			/** Bitmap of harts whose HW state needs to be checked */
+			rpmi_uint32_t *pending;
+
+			/** Non-zero if any bit of the pending bitmap is set */
+			rpmi_uint32_t pending_any;
 		} leaf;
 
 		/** Details required by non-leaf instance */
@@ -67,144 +95,241 @@ struct rpmi_hsm {
 
 			/** Array of child instance pointers */
 			struct rpmi_hsm **child_array;
+
+			/** Leaf instance of each hart indexed by hart index */
+			struct rpmi_hsm **hart_leaf;
+
+			/** Hart index within the leaf instance of each hart */
+			rpmi_uint32_t *hart_leaf_index;
 		} nonleaf;
 	};
 };
 
 rpmi_uint32_t rpmi_hsm_hart_count(struct rpmi_hsm *hsm)
 {
-	struct rpmi_hsm *child_hsm;
-	rpmi_uint32_t i, ret;
+	return (hsm) ? hsm->hart_count : 0;
+}
+
+rpmi_uint32_t rpmi_hsm_hart_index2id(struct rpmi_hsm *hsm, rpmi_uint32_t hart_index)
+{
+	if (!hsm || hsm->hart_count <= hart_index)
+		return LIBRPMI_HSM_INVALID_HART_ID;
+
+	return hsm->hart_ids[hart_index];
+}
+
+const rpmi_uint32_t *rpmi_hsm_hart_id_array(struct rpmi_hsm *hsm)
+{
+	return (hsm) ? hsm->hart_ids : NULL;
+}
+
+rpmi_uint32_t rpmi_hsm_hart_id2index(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id)
+{
+	rpmi_uint32_t lo, hi, mid;
 
 	if (!hsm)
-		return 0;
+		return LIBRPMI_HSM_INVALID_HART_INDEX;
 
-	if (!hsm->is_non_leaf)
-		return hsm->leaf.hart_count;
+	if (hsm->linear_ids) {
+		/* Hart IDs below hart_ids[0] wrap around to large values */
+		mid = hart_id - hsm->hart_ids[0];
+		return (mid < hsm->hart_count) ? mid : LIBRPMI_HSM_INVALID_HART_INDEX;
+	}
 
-	ret = 0;
-	for (i = 0; i < hsm->nonleaf.child_count; i++) {
-		child_hsm = hsm->nonleaf.child_array[i];
-		ret += rpmi_hsm_hart_count(child_hsm);
+	/* Lowest hart index is found first if a hart ID is repeated */
+	lo = 0;
+	hi = hsm->hart_count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (hsm->id_map[mid].hart_id < hart_id)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
-	return ret;
+	if (lo < hsm->hart_count && hsm->id_map[lo].hart_id == hart_id)
+		return hsm->id_map[lo].hart_index;
+
+	return LIBRPMI_HSM_INVALID_HART_INDEX;
 }
 
-static struct rpmi_hsm *rpmi_hsm_hart_index2child(struct rpmi_hsm *hsm,
-						  rpmi_uint32_t hart_index,
-						  rpmi_uint32_t *child_rel_index_ptr)
+/* Find the leaf instance of a hart and the hart index within it */
+static struct rpmi_hsm *rpmi_hsm_hart_id2leaf(struct rpmi_hsm *hsm,
+					      rpmi_uint32_t hart_id,
+					      rpmi_uint32_t *leaf_index)
 {
-	rpmi_uint32_t i, count, child_rel_index;
-	struct rpmi_hsm *child_hsm;
+	rpmi_uint32_t hart_index;
 
-	if (!hsm->is_non_leaf)
+	hart_index = rpmi_hsm_hart_id2index(hsm, hart_id);
+	if (hart_index == LIBRPMI_HSM_INVALID_HART_INDEX)
 		return NULL;
 
-	child_rel_index = 0;
-	for (i = 0; i < hsm->nonleaf.child_count; i++) {
-		child_hsm = hsm->nonleaf.child_array[i];
-
-		count = rpmi_hsm_hart_count(child_hsm);
-		if (child_rel_index <= hart_index &&
-		    hart_index < (child_rel_index + count)) {
-			if (child_rel_index_ptr)
-				*child_rel_index_ptr = child_rel_index;
-			return child_hsm;
-		}
-
-		child_rel_index += count;
+	if (!hsm->is_non_leaf) {
+		*leaf_index = hart_index;
+		return hsm;
 	}
 
-	return NULL;
+	*leaf_index = hsm->nonleaf.hart_leaf_index[hart_index];
+	return hsm->nonleaf.hart_leaf[hart_index];
 }
 
-rpmi_uint32_t rpmi_hsm_hart_index2id(struct rpmi_hsm *hsm, rpmi_uint32_t hart_index)
+static inline rpmi_bool_t rpmi_hsm_id_map_less(const struct rpmi_hsm_id_map *a,
+					       const struct rpmi_hsm_id_map *b)
 {
-	rpmi_uint32_t child_rel_index;
-	struct rpmi_hsm *child_hsm;
+	if (a->hart_id != b->hart_id)
+		return a->hart_id < b->hart_id;
 
-	if (!hsm || rpmi_hsm_hart_count(hsm) <= hart_index)
-		return LIBRPMI_HSM_INVALID_HART_ID;
+	return a->hart_index < b->hart_index;
+}
 
-	if (!hsm->is_non_leaf)
-		return hsm->leaf.hart_ids[hart_index];
+static void rpmi_hsm_id_map_sift(struct rpmi_hsm_id_map *map,
+				 rpmi_uint32_t root, rpmi_uint32_t count)
+{
+	struct rpmi_hsm_id_map tmp;
+	rpmi_uint32_t child;
 
-	child_hsm = rpmi_hsm_hart_index2child(hsm, hart_index, &child_rel_index);
-	if (child_hsm)
-		return rpmi_hsm_hart_index2id(child_hsm, hart_index - child_rel_index);
+	while ((child = 2 * root + 1) < count) {
+		if (child + 1 < count && rpmi_hsm_id_map_less(&map[child], &map[child + 1]))
+			child++;
+		if (!rpmi_hsm_id_map_less(&map[root], &map[child]))
+			break;
 
-	return LIBRPMI_HSM_INVALID_HART_ID;
+		tmp = map[root];
+		map[root] = map[child];
+		map[child] = tmp;
+		root = child;
+	}
 }
 
-rpmi_uint32_t rpmi_hsm_hart_id2index(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id)
+/* Build the hart ID lookup table once so lookups don't scan all harts */
+static enum rpmi_error rpmi_hsm_build_id_map(struct rpmi_hsm *hsm)
 {
-	rpmi_uint32_t i, hart_count;
+	struct rpmi_hsm_id_map *map, tmp;
+	rpmi_uint32_t i;
 
-	if (!hsm)
-		return LIBRPMI_HSM_INVALID_HART_INDEX;
+	hsm->linear_ids = true;
+	for (i = 1; i < hsm->hart_count; i++) {
+		if (hsm->hart_ids[i] != hsm->hart_ids[0] + i) {
+			hsm->linear_ids = false;
+			break;
+		}
+	}
+	if (hsm->linear_ids)
+		return RPMI_SUCCESS;
 
-	hart_count = rpmi_hsm_hart_count(hsm);
-	for (i = 0; i < hart_count; i++) {
-		if (rpmi_hsm_hart_index2id(hsm, i) == hart_id)
-			return i;
+	map = rpmi_env_zalloc(hsm->hart_count * sizeof(*map));
+	if (!map)
+		return RPMI_ERR_FAILED;
+
+	for (i = 0; i < hsm->hart_count; i++) {
+		map[i].hart_id = hsm->hart_ids[i];
+		map[i].hart_index = i;
 	}
 
-	return LIBRPMI_HSM_INVALID_HART_INDEX;
+	/* Heap sort */
+	for (i = hsm->hart_count / 2; i > 0; i--)
+		rpmi_hsm_id_map_sift(map, i - 1, hsm->hart_count);
+	for (i = hsm->hart_count - 1; i > 0; i--) {
+		tmp = map[0];
+		map[0] = map[i];
+		map[i] = tmp;
+		rpmi_hsm_id_map_sift(map, 0, i);
+	}
+
+	hsm->id_map = map;
+	return RPMI_SUCCESS;
 }
 
-rpmi_uint32_t rpmi_hsm_get_suspend_type_count(struct rpmi_hsm *hsm)
+/* Build the suspend type lookup table so that type values are binary searched */
+static enum rpmi_error rpmi_hsm_build_suspend_type_map(struct rpmi_hsm *hsm)
 {
-	if (!hsm)
-		return 0;
+	const struct rpmi_hsm_suspend_type **map, *tmp;
+	rpmi_uint32_t i, j;
+
+	if (!hsm->suspend_type_count)
+		return RPMI_SUCCESS;
+
+	map = rpmi_env_zalloc(hsm->suspend_type_count * sizeof(*map));
+	if (!map)
+		return RPMI_ERR_FAILED;
+
+	/*
+	 * Insertion sort is enough for the few suspend types of a platform
+	 * and being stable it keeps the first of the repeated type values
+	 * in front.
+	 */
+	for (i = 0; i < hsm->suspend_type_count; i++) {
+		tmp = &hsm->suspend_types[i];
+		for (j = i; j > 0 && map[j - 1]->type > tmp->type; j--)
+			map[j] = map[j - 1];
+		map[j] = tmp;
+	}
 
-	if (!hsm->is_non_leaf)
-		return hsm->leaf.suspend_type_count;
+	hsm->suspend_type_map = map;
+	return RPMI_SUCCESS;
+}
 
-	/* For non-leaf, return the suspend type count of first child */
-	return rpmi_hsm_get_suspend_type_count(hsm->nonleaf.child_array[0]);
+rpmi_uint32_t rpmi_hsm_get_suspend_type_count(struct rpmi_hsm *hsm)
+{
+	return (hsm) ? hsm->suspend_type_count : 0;
 }
 
 const struct rpmi_hsm_suspend_type *rpmi_hsm_get_suspend_type(struct rpmi_hsm *hsm,
 							rpmi_uint32_t suspend_type_index)
 {
-	if (!hsm || rpmi_hsm_get_suspend_type_count(hsm) <= suspend_type_index)
+	if (!hsm || hsm->suspend_type_count <= suspend_type_index)
 		return NULL;
 
-	if (!hsm->is_non_leaf)
-		return &hsm->leaf.suspend_types[suspend_type_index];
-
-	/* For non-leaf, return the suspend type of first child */
-	return rpmi_hsm_get_suspend_type(hsm->nonleaf.child_array[0], suspend_type_index);
+	return &hsm->suspend_types[suspend_type_index];
 }
 
 const struct rpmi_hsm_suspend_type *rpmi_hsm_find_suspend_type(struct rpmi_hsm *hsm,
 							       rpmi_uint32_t type)
 {
-	const struct rpmi_hsm_suspend_type *suspend_type;
-	rpmi_uint32_t i, suspend_type_count;
+	rpmi_uint32_t lo, hi, mid;
 
 	if (!hsm)
 		return NULL;
 
-	suspend_type_count = rpmi_hsm_get_suspend_type_count(hsm);
-	for (i = 0; i < suspend_type_count; i++) {
-		suspend_type = rpmi_hsm_get_suspend_type(hsm, i);
-		if (suspend_type->type == type)
-			return suspend_type;
+	lo = 0;
+	hi = hsm->suspend_type_count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (hsm->suspend_type_map[mid]->type < type)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
+	if (lo < hsm->suspend_type_count && hsm->suspend_type_map[lo]->type == type)
+		return hsm->suspend_type_map[lo];
+
 	return NULL;
 }
 
-static void __rpmi_hsm_process_hart_state_changes(struct rpmi_hsm *hsm,
-						  struct rpmi_hsm_hart *hart,
-						  rpmi_uint32_t hart_index)
+static void rpmi_hsm_mark_pending(struct rpmi_hsm *hsm, rpmi_uint32_t hart_index)
+{
+	rpmi_env_atomic_or32(&hsm->leaf.pending[hart_index / 32],
+			     1U << (hart_index % 32));
+	rpmi_env_atomic_or32(&hsm->leaf.pending_any, 1);
+}
+
+/* Get harts marked pending checked by the next event processing */
+static void rpmi_hsm_mark_group_pending(struct rpmi_hsm *hsm)
+{
+	if (hsm->cntx)
+		rpmi_context_mark_group_pending(hsm->cntx, RPMI_SRVGRP_HSM);
+}
+
+/* Returns true if the hart is still in transition (a *_PENDING state) */
+static rpmi_bool_t __rpmi_hsm_process_hart_state_changes(struct rpmi_hsm *hsm,
+							 struct rpmi_hsm_hart *hart,
+							 rpmi_uint32_t hart_index)
 {
 	enum rpmi_hart_hw_state hw_state;
 
 	if (hsm->is_non_leaf)
-		return;
+		return false;
 
 	hw_state = hsm->leaf.ops->hart_get_hw_state(hsm->leaf.ops_priv, hart_index);
 	if ((rpmi_int32_t)hart->state < 0) {
@@ -255,13 +380,32 @@ static void __rpmi_hsm_process_hart_state_changes(struct rpmi_hsm *hsm,
 			break;
 		}
 	}
+
+	/*
+	 * Harts in transition are checked again and so are suspended
+	 * harts unless the platform notifies their wakeup.
+	 */
+	switch (hart->state) {
+	case RPMI_HSM_HART_STATE_START_PENDING:
+	case RPMI_HSM_HART_STATE_STOP_PENDING:
+	case RPMI_HSM_HART_STATE_SUSPEND_PENDING:
+		rpmi_hsm_mark_pending(hsm, hart_index);
+		return true;
+	case RPMI_HSM_HART_STATE_SUSPENDED:
+		if (!hsm->wakeup_notify)
+			rpmi_hsm_mark_pending(hsm, hart_index);
+		break;
+	default:
+		break;
+	}
+
+	return false;
 }
 
 enum rpmi_error rpmi_hsm_hart_start(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id,
 				    rpmi_uint64_t start_addr)
 {
 	struct rpmi_hsm_hart *hart;
-	struct rpmi_hsm *child_hsm;
 	rpmi_uint32_t hart_index;
 	enum rpmi_error ret;
 
@@ -270,17 +414,13 @@ enum rpmi_error rpmi_hsm_hart_start(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id,
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	hart_index = rpmi_hsm_hart_id2index(hsm, hart_id);
-	if (hart_index == LIBRPMI_HSM_INVALID_HART_INDEX) {
+	/* Non-leaf instances resolve the leaf instance directly */
+	hsm = rpmi_hsm_hart_id2leaf(hsm, hart_id, &hart_index);
+	if (!hsm) {
 		DPRINTF("%s: invalid hart_id 0x%x\n", __func__, hart_id);
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	if (hsm->is_non_leaf) {
-		child_hsm = rpmi_hsm_hart_index2child(hsm, hart_index, NULL);
-		return rpmi_hsm_hart_start(child_hsm, hart_id, start_addr);
-	}
-
 	if (!hsm->leaf.ops->hart_start_prepare || !hsm->leaf.ops->hart_start_finalize) {
 		DPRINTF("%s: not supported\n", __func__);
 		return RPMI_ERR_NOTSUPP;
@@ -319,13 +459,13 @@ enum rpmi_error rpmi_hsm_hart_start(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id,
 	__rpmi_hsm_process_hart_state_changes(hsm, hart, hart_index);
 
 	rpmi_env_unlock(hart->lock);
+	rpmi_hsm_mark_group_pending(hsm);
 	return RPMI_SUCCESS;
 }
 
 enum rpmi_error rpmi_hsm_hart_stop(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id)
 {
 	struct rpmi_hsm_hart *hart;
-	struct rpmi_hsm *child_hsm;
 	rpmi_uint32_t hart_index;
 	enum rpmi_error ret;
 
@@ -334,17 +474,13 @@ enum rpmi_error rpmi_hsm_hart_stop(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id)
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	hart_index = rpmi_hsm_hart_id2index(hsm, hart_id);
-	if (hart_index == LIBRPMI_HSM_INVALID_HART_INDEX) {
+	/* Non-leaf instances resolve the leaf instance directly */
+	hsm = rpmi_hsm_hart_id2leaf(hsm, hart_id, &hart_index);
+	if (!hsm) {
 		DPRINTF("%s: invalid hart_id 0x%x\n", __func__, hart_id);
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	if (hsm->is_non_leaf) {
-		child_hsm = rpmi_hsm_hart_index2child(hsm, hart_index, NULL);
-		return rpmi_hsm_hart_stop(child_hsm, hart_id);
-	}
-
 	if (!hsm->leaf.ops->hart_stop_prepare || !hsm->leaf.ops->hart_stop_finalize) {
 		DPRINTF("%s: not supported\n", __func__);
 		return RPMI_ERR_NOTSUPP;
@@ -382,6 +518,7 @@ enum rpmi_error rpmi_hsm_hart_stop(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id)
 	__rpmi_hsm_process_hart_state_changes(hsm, hart, hart_index);
 
 	rpmi_env_unlock(hart->lock);
+	rpmi_hsm_mark_group_pending(hsm);
 	return RPMI_SUCCESS;
 }
 
@@ -390,7 +527,6 @@ enum rpmi_error rpmi_hsm_hart_suspend(struct rpmi_hsm *hsm, rpmi_uint32_t hart_i
 				rpmi_uint64_t resume_addr)
 {
 	struct rpmi_hsm_hart *hart;
-	struct rpmi_hsm *child_hsm;
 	rpmi_uint32_t hart_index;
 	enum rpmi_error ret;
 
@@ -399,18 +535,13 @@ enum rpmi_error rpmi_hsm_hart_suspend(struct rpmi_hsm *hsm, rpmi_uint32_t hart_i
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	hart_index = rpmi_hsm_hart_id2index(hsm, hart_id);
-	if (hart_index == LIBRPMI_HSM_INVALID_HART_INDEX) {
+	/* Non-leaf instances resolve the leaf instance directly */
+	hsm = rpmi_hsm_hart_id2leaf(hsm, hart_id, &hart_index);
+	if (!hsm) {
 		DPRINTF("%s: invalid hart_id 0x%x\n", __func__, hart_id);
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	if (hsm->is_non_leaf) {
-		child_hsm = rpmi_hsm_hart_index2child(hsm, hart_index, NULL);
-		return rpmi_hsm_hart_suspend(child_hsm, hart_id, suspend_type,
-					     resume_addr);
-	}
-
 	if (!hsm->leaf.ops->hart_suspend_prepare || !hsm->leaf.ops->hart_suspend_finalize) {
 		DPRINTF("%s: not supported\n", __func__);
 		return RPMI_ERR_NOTSUPP;
@@ -451,13 +582,285 @@ enum rpmi_error rpmi_hsm_hart_suspend(struct rpmi_hsm *hsm, rpmi_uint32_t hart_i
 	__rpmi_hsm_process_hart_state_changes(hsm, hart, hart_index);
 
 	rpmi_env_unlock(hart->lock);
+	rpmi_hsm_mark_group_pending(hsm);
 	return RPMI_SUCCESS;
 }
 
+/* Harts selected by a hart mask resolved to their leaf instances */
+struct rpmi_hsm_hart_set {
+	rpmi_uint32_t count;
+	rpmi_uint32_t bit[32];
+	struct rpmi_hsm *leaf[32];
+	rpmi_uint32_t index[32];
+};
+
+/* Parameters of a bulk start or suspend */
+struct rpmi_hsm_bulk_op {
+	rpmi_bool_t is_suspend;
+	const struct rpmi_hsm_suspend_type *suspend_type;
+	rpmi_uint64_t addr;
+};
+
+static enum rpmi_error rpmi_hsm_resolve_mask(struct rpmi_hsm *hsm,
+					     rpmi_uint32_t hart_id_base,
+					     rpmi_uint32_t hart_mask,
+					     struct rpmi_hsm_hart_set *set)
+{
+	rpmi_uint32_t i, hart_id;
+
+	set->count = 0;
+	for (i = 0; i < 32; i++) {
+		if (!(hart_mask & (1U << i)))
+			continue;
+
+		hart_id = hart_id_base + i;
+		set->leaf[set->count] = rpmi_hsm_hart_id2leaf(hsm, hart_id,
+							&set->index[set->count]);
+		if (!set->leaf[set->count]) {
+			DPRINTF("%s: invalid hart_id 0x%x\n", __func__, hart_id);
+			return RPMI_ERR_INVALID_PARAM;
+		}
+		set->bit[set->count] = i;
+		set->count++;
+	}
+
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error rpmi_hsm_bulk_prepare_one(struct rpmi_hsm *leaf,
+						 rpmi_uint32_t hart_index,
+						 const struct rpmi_hsm_bulk_op *op)
+{
+	const struct rpmi_hsm_platform_ops *ops = leaf->leaf.ops;
+
+	if (op->is_suspend)
+		return ops->hart_suspend_prepare(leaf->leaf.ops_priv, hart_index,
+						 op->suspend_type, op->addr);
+
+	return ops->hart_start_prepare(leaf->leaf.ops_priv, hart_index, op->addr);
+}
+
+static enum rpmi_error rpmi_hsm_bulk_prepare_mask(struct rpmi_hsm *leaf,
+						  rpmi_uint32_t hart_index_base,
+						  rpmi_uint64_t hart_index_mask,
+						  const struct rpmi_hsm_bulk_op *op)
+{
+	const struct rpmi_hsm_platform_ops *ops = leaf->leaf.ops;
+
+	if (op->is_suspend)
+		return ops->hart_suspend_prepare_mask(leaf->leaf.ops_priv,
+						      hart_index_base,
+						      hart_index_mask,
+						      op->suspend_type, op->addr);
+
+	return ops->hart_start_prepare_mask(leaf->leaf.ops_priv, hart_index_base,
+					    hart_index_mask, op->addr);
+}
+
+/*
+ * Start or suspend the harts of a set (selected by sel) which belong to
+ * the same leaf instance. Returns the harts of the set which failed.
+ */
+static rpmi_uint32_t rpmi_hsm_bulk_leaf(struct rpmi_hsm *leaf,
+					const struct rpmi_hsm_hart_set *set,
+					rpmi_uint32_t sel,
+					const struct rpmi_hsm_bulk_op *op,
+					enum rpmi_error *err)
+{
+	const struct rpmi_hsm_platform_ops *ops = leaf->leaf.ops;
+	rpmi_uint32_t k, base, eligible = 0, batch, failed = 0;
+	enum rpmi_hsm_hart_state from, pending, done;
+	rpmi_uint64_t index_mask;
+	struct rpmi_hsm_hart *hart;
+	rpmi_bool_t use_mask;
+	enum rpmi_error rc;
+
+	if (op->is_suspend) {
+		if (!ops->hart_suspend_finalize ||
+		    (!ops->hart_suspend_prepare && !ops->hart_suspend_prepare_mask)) {
+			*err = RPMI_ERR_NOTSUPP;
+			return sel;
+		}
+		use_mask = ops->hart_suspend_prepare_mask ? true : false;
+		from = RPMI_HSM_HART_STATE_STARTED;
+		pending = RPMI_HSM_HART_STATE_SUSPEND_PENDING;
+		done = RPMI_HSM_HART_STATE_SUSPENDED;
+	} else {
+		if (!ops->hart_start_finalize ||
+		    (!ops->hart_start_prepare && !ops->hart_start_prepare_mask)) {
+			*err = RPMI_ERR_NOTSUPP;
+			return sel;
+		}
+		use_mask = ops->hart_start_prepare_mask ? true : false;
+		from = RPMI_HSM_HART_STATE_STOPPED;
+		pending = RPMI_HSM_HART_STATE_START_PENDING;
+		done = RPMI_HSM_HART_STATE_STARTED;
+	}
+
+	/* Hart locks are always taken in increasing hart ID order */
+	for (k = 0; k < set->count; k++) {
+		if (!(sel & (1U << k)))
+			continue;
+
+		hart = &leaf->leaf.harts[set->index[k]];
+		rpmi_env_lock(hart->lock);
+		if (hart->state == done || hart->state == pending)
+			continue;
+		if (hart->state != from) {
+			*err = RPMI_ERR_DENIED;
+			failed |= 1U << k;
+			continue;
+		}
+		eligible |= 1U << k;
+	}
+
+	while (eligible) {
+		/* Lowest selected hart index starts the window of the batch */
+		base = -1U;
+		for (k = 0; k < set->count; k++) {
+			if ((eligible & (1U << k)) && set->index[k] < base)
+				base = set->index[k];
+		}
+
+		batch = 0;
+		index_mask = 0;
+		for (k = 0; k < set->count; k++) {
+			if (!(eligible & (1U << k)))
+				continue;
+			if (!use_mask) {
+				if (set->index[k] != base)
+					continue;
+			} else if (set->index[k] - base >= 64) {
+				continue;
+			}
+			batch |= 1U << k;
+			index_mask |= 1ULL << (set->index[k] - base);
+		}
+		eligible &= ~batch;
+
+		if (use_mask)
+			rc = rpmi_hsm_bulk_prepare_mask(leaf, base, index_mask, op);
+		else
+			rc = rpmi_hsm_bulk_prepare_one(leaf, base, op);
+		if (rc) {
+			DPRINTF("%s: prepare failed for hart index base 0x%x\n",
+				__func__, base);
+			*err = rc;
+			failed |= batch;
+			continue;
+		}
+
+		for (k = 0; k < set->count; k++) {
+			if (!(batch & (1U << k)))
+				continue;
+
+			hart = &leaf->leaf.harts[set->index[k]];
+			if (op->is_suspend) {
+				hart->suspend_type = op->suspend_type;
+				hart->resume_addr = op->addr;
+			} else {
+				hart->start_addr = op->addr;
+			}
+			hart->state = pending;
+			__rpmi_hsm_process_hart_state_changes(leaf, hart, set->index[k]);
+		}
+	}
+
+	for (k = 0; k < set->count; k++) {
+		if (sel & (1U << k))
+			rpmi_env_unlock(leaf->leaf.harts[set->index[k]].lock);
+	}
+
+	return failed;
+}
+
+static enum rpmi_error rpmi_hsm_bulk(struct rpmi_hsm *hsm,
+				     rpmi_uint32_t hart_id_base,
+				     rpmi_uint32_t hart_mask,
+				     const struct rpmi_hsm_bulk_op *op,
+				     rpmi_uint32_t *failed_mask)
+{
+	rpmi_uint32_t i, k, sel, failed, todo, ret_mask = 0;
+	struct rpmi_hsm_hart_set set;
+	enum rpmi_error rc = RPMI_SUCCESS;
+
+	if (failed_mask)
+		*failed_mask = hart_mask;
+
+	if (rpmi_hsm_resolve_mask(hsm, hart_id_base, hart_mask, &set))
+		return RPMI_ERR_INVALID_PARAM;
+
+	/* Harts are handed to the platform per leaf instance */
+	todo = (set.count < 32) ? ((1U << set.count) - 1) : -1U;
+	for (i = 0; i < set.count; i++) {
+		if (!(todo & (1U << i)))
+			continue;
+
+		sel = 0;
+		for (k = i; k < set.count; k++) {
+			if (set.leaf[k] == set.leaf[i])
+				sel |= 1U << k;
+		}
+		todo &= ~sel;
+
+		failed = rpmi_hsm_bulk_leaf(set.leaf[i], &set, sel, op, &rc);
+		for (k = i; k < set.count; k++) {
+			if (failed & (1U << k))
+				ret_mask |= 1U << set.bit[k];
+		}
+	}
+
+	if (failed_mask)
+		*failed_mask = ret_mask;
+	rpmi_hsm_mark_group_pending(hsm);
+
+	return rc;
+}
+
+enum rpmi_error rpmi_hsm_hart_start_mask(struct rpmi_hsm *hsm,
+					 rpmi_uint32_t hart_id_base,
+					 rpmi_uint32_t hart_mask,
+					 rpmi_uint64_t start_addr,
+					 rpmi_uint32_t *failed_mask)
+{
+	struct rpmi_hsm_bulk_op op = {
+		.is_suspend = false,
+		.suspend_type = NULL,
+		.addr = start_addr,
+	};
+
+	if (!hsm) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	return rpmi_hsm_bulk(hsm, hart_id_base, hart_mask, &op, failed_mask);
+}
+
+enum rpmi_error rpmi_hsm_hart_suspend_mask(struct rpmi_hsm *hsm,
+				rpmi_uint32_t hart_id_base,
+				rpmi_uint32_t hart_mask,
+				const struct rpmi_hsm_suspend_type *suspend_type,
+				rpmi_uint64_t resume_addr,
+				rpmi_uint32_t *failed_mask)
+{
+	struct rpmi_hsm_bulk_op op = {
+		.is_suspend = true,
+		.suspend_type = suspend_type,
+		.addr = resume_addr,
+	};
+
+	if (!hsm || !suspend_type) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	return rpmi_hsm_bulk(hsm, hart_id_base, hart_mask, &op, failed_mask);
+}
+
 int rpmi_hsm_get_hart_state(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id)
 {
 	enum rpmi_hsm_hart_state state;
-	struct rpmi_hsm *child_hsm;
 	struct rpmi_hsm_hart *hart;
 	rpmi_uint32_t hart_index;
 
@@ -466,17 +869,13 @@ int rpmi_hsm_get_hart_state(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id)
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	hart_index = rpmi_hsm_hart_id2index(hsm, hart_id);
-	if (hart_index == LIBRPMI_HSM_INVALID_HART_INDEX) {
+	/* Non-leaf instances resolve the leaf instance directly */
+	hsm = rpmi_hsm_hart_id2leaf(hsm, hart_id, &hart_index);
+	if (!hsm) {
 		DPRINTF("%s: invalid hart_id 0x%x\n", __func__, hart_id);
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	if (hsm->is_non_leaf) {
-		child_hsm = rpmi_hsm_hart_index2child(hsm, hart_index, NULL);
-		return rpmi_hsm_get_hart_state(child_hsm, hart_id);
-	}
-
 	hart = &hsm->leaf.harts[hart_index];
 	rpmi_env_lock(hart->lock);
 	state = hart->state;
@@ -485,27 +884,91 @@ int rpmi_hsm_get_hart_state(struct rpmi_hsm *hsm, rpmi_uint32_t hart_id)
 	return state;
 }
 
-void rpmi_hsm_process_state_changes(struct rpmi_hsm *hsm)
+rpmi_bool_t rpmi_hsm_process_state_changes(struct rpmi_hsm *hsm)
 {
+	rpmi_bool_t in_transition = false;
+	rpmi_uint32_t i, w, bits;
 	struct rpmi_hsm_hart *hart;
-	rpmi_uint32_t i;
 
 	if (!hsm) {
 		DPRINTF("%s: invalid parameters\n", __func__);
-		return;
+		return false;
 	}
 
 	if (hsm->is_non_leaf) {
-		for (i = 0; i < hsm->nonleaf.child_count; i++)
-			rpmi_hsm_process_state_changes(hsm->nonleaf.child_array[i]);
-	} else {
-		for (i = 0; i < hsm->leaf.hart_count; i++) {
+		for (i = 0; i < hsm->nonleaf.child_count; i++) {
+			if (rpmi_hsm_process_state_changes(hsm->nonleaf.child_array[i]))
+				in_transition = true;
+		}
+		return in_transition;
+	}
+
+	/* Only harts marked pending are checked */
+	if (!rpmi_env_atomic_xchg32(&hsm->leaf.pending_any, 0))
+		return false;
+
+	for (w = 0; w * 32 < hsm->hart_count; w++) {
+		bits = rpmi_env_atomic_xchg32(&hsm->leaf.pending[w], 0);
+		for (i = w * 32; bits; i++, bits >>= 1) {
+			if (!(bits & 1))
+				continue;
+
 			hart = &hsm->leaf.harts[i];
 			rpmi_env_lock(hart->lock);
-			__rpmi_hsm_process_hart_state_changes(hsm, hart, i);
+			if (__rpmi_hsm_process_hart_state_changes(hsm, hart, i))
+				in_transition = true;
 			rpmi_env_unlock(hart->lock);
 		}
 	}
+
+	return in_transition;
+}
+
+enum rpmi_error rpmi_hsm_notify_hw_state(struct rpmi_hsm *hsm,
+					 rpmi_uint32_t hart_index)
+{
+	if (!hsm || hsm->hart_count <= hart_index) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	if (hsm->is_non_leaf) {
+		rpmi_hsm_mark_pending(hsm->nonleaf.hart_leaf[hart_index],
+				      hsm->nonleaf.hart_leaf_index[hart_index]);
+	} else {
+		rpmi_hsm_mark_pending(hsm, hart_index);
+	}
+	rpmi_hsm_mark_group_pending(hsm);
+
+	return RPMI_SUCCESS;
+}
+
+void rpmi_hsm_set_wakeup_notify(struct rpmi_hsm *hsm, rpmi_bool_t enable)
+{
+	rpmi_uint32_t i;
+
+	if (!hsm) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return;
+	}
+
+	hsm->wakeup_notify = enable;
+	if (hsm->is_non_leaf) {
+		for (i = 0; i < hsm->nonleaf.child_count; i++)
+			rpmi_hsm_set_wakeup_notify(hsm->nonleaf.child_array[i],
+						   enable);
+	}
+}
+
+void rpmi_hsm_set_context(struct rpmi_hsm *hsm, struct rpmi_context *cntx)
+{
+	rpmi_uint32_t i;
+
+	hsm->cntx = cntx;
+	if (hsm->is_non_leaf) {
+		for (i = 0; i < hsm->nonleaf.child_count; i++)
+			rpmi_hsm_set_context(hsm->nonleaf.child_array[i], cntx);
+	}
 }
 
 struct rpmi_hsm *rpmi_hsm_create(rpmi_uint32_t hart_count,
@@ -538,23 +1001,51 @@ struct rpmi_hsm *rpmi_hsm_create(rpmi_uint32_t hart_count,
 		return NULL;
 	}
 
-	hsm->leaf.hart_count = hart_count;
-	hsm->leaf.hart_ids = hart_ids;
+	hsm->hart_count = hart_count;
+	hsm->hart_ids = hart_ids;
 
-	hsm->leaf.harts = rpmi_env_zalloc(hsm->leaf.hart_count * sizeof(*hsm->leaf.harts));
+	hsm->leaf.harts = rpmi_env_zalloc(hsm->hart_count * sizeof(*hsm->leaf.harts));
 	if (!hsm->leaf.harts) {
 		DPRINTF("%s: failed to allocate hart array\n", __func__);
 		rpmi_env_free(hsm);
 		return NULL;
 	}
 
-	for (i = 0; i < hsm->leaf.hart_count; i++) {
+	hsm->leaf.pending = rpmi_env_zalloc(((hart_count + 31) / 32) *
+					    sizeof(*hsm->leaf.pending));
+	if (!hsm->leaf.pending) {
+		DPRINTF("%s: failed to allocate pending hart bitmap\n", __func__);
+		rpmi_env_free(hsm->leaf.harts);
+		rpmi_env_free(hsm);
+		return NULL;
+	}
+
+	if (rpmi_hsm_build_id_map(hsm)) {
+		DPRINTF("%s: failed to allocate hart ID lookup table\n", __func__);
+		rpmi_env_free(hsm->leaf.pending);
+		rpmi_env_free(hsm->leaf.harts);
+		rpmi_env_free(hsm);
+		return NULL;
+	}
+
+	hsm->suspend_type_count = suspend_type_count;
+	hsm->suspend_types = suspend_types;
+	if (rpmi_hsm_build_suspend_type_map(hsm)) {
+		DPRINTF("%s: failed to allocate suspend type lookup table\n", __func__);
+		rpmi_env_free(hsm->id_map);
+		rpmi_env_free(hsm->leaf.pending);
+		rpmi_env_free(hsm->leaf.harts);
+		rpmi_env_free(hsm);
+		return NULL;
+	}
+
+	/* Initial state of every hart is read from the HW */
+	for (i = 0; i < hsm->hart_count; i++) {
 		hsm->leaf.harts[i].lock = rpmi_env_alloc_lock();
 		hsm->leaf.harts[i].state = -1;
+		rpmi_hsm_mark_pending(hsm, i);
 	}
 
-	hsm->leaf.suspend_type_count = suspend_type_count;
-	hsm->leaf.suspend_types = suspend_types;
 	hsm->leaf.ops = ops;
 	hsm->leaf.ops_priv = ops_priv;
 
@@ -567,8 +1058,9 @@ struct rpmi_hsm *rpmi_hsm_nonleaf_create(rpmi_uint32_t child_count,
 					 struct rpmi_hsm **child_array)
 {
 	const struct rpmi_hsm_suspend_type *suspend_type, *ref_suspend_type;
-	rpmi_uint32_t i, j, suspend_type_count = 0;
+	rpmi_uint32_t i, j, k, hart_count = 0, suspend_type_count = 0;
 	struct rpmi_hsm *hsm, *child_hsm;
+	rpmi_uint32_t *hart_ids;
 
 	/* Critical parameters should be non-zero */
 	if (!child_count || !child_array) {
@@ -583,6 +1075,7 @@ struct rpmi_hsm *rpmi_hsm_nonleaf_create(rpmi_uint32_t child_count,
 			DPRINTF("%s: child%d is NULL\n", __func__, i);
 			return NULL;
 		}
+		hart_count += child_hsm->hart_count;
 
 		if (!i) {
 			suspend_type_count = rpmi_hsm_get_suspend_type_count(child_hsm);
@@ -656,8 +1149,57 @@ struct rpmi_hsm *rpmi_hsm_nonleaf_create(rpmi_uint32_t child_count,
 	hsm->is_non_leaf = true;
 	hsm->nonleaf.child_count = child_count;
 	hsm->nonleaf.child_array = child_array;
+	hsm->hart_count = hart_count;
+
+	hart_ids = rpmi_env_zalloc(hart_count * sizeof(*hart_ids));
+	hsm->nonleaf.hart_leaf = rpmi_env_zalloc(hart_count *
+						 sizeof(*hsm->nonleaf.hart_leaf));
+	hsm->nonleaf.hart_leaf_index = rpmi_env_zalloc(hart_count *
+						sizeof(*hsm->nonleaf.hart_leaf_index));
+	hsm->hart_ids = hart_ids;
+	if (!hart_ids || !hsm->nonleaf.hart_leaf || !hsm->nonleaf.hart_leaf_index) {
+		DPRINTF("%s: failed to allocate hart tables\n", __func__);
+		goto fail_free_tables;
+	}
+
+	/* Flatten the hierarchy so hart lookups don't walk the children */
+	for (i = 0, k = 0; i < child_count; i++) {
+		child_hsm = child_array[i];
+		for (j = 0; j < child_hsm->hart_count; j++, k++) {
+			hart_ids[k] = child_hsm->hart_ids[j];
+			if (child_hsm->is_non_leaf) {
+				hsm->nonleaf.hart_leaf[k] = child_hsm->nonleaf.hart_leaf[j];
+				hsm->nonleaf.hart_leaf_index[k] =
+					child_hsm->nonleaf.hart_leaf_index[j];
+			} else {
+				hsm->nonleaf.hart_leaf[k] = child_hsm;
+				hsm->nonleaf.hart_leaf_index[k] = j;
+			}
+		}
+	}
+
+	if (rpmi_hsm_build_id_map(hsm)) {
+		DPRINTF("%s: failed to allocate hart ID lookup table\n", __func__);
+		goto fail_free_tables;
+	}
+
+	/* Suspend types of all children match so share those of first child */
+	hsm->suspend_type_count = suspend_type_count;
+	hsm->suspend_types = child_array[0]->suspend_types;
+	if (rpmi_hsm_build_suspend_type_map(hsm)) {
+		DPRINTF("%s: failed to allocate suspend type lookup table\n", __func__);
+		goto fail_free_tables;
+	}
 
 	return hsm;
+
+fail_free_tables:
+	rpmi_env_free(hsm->id_map);
+	rpmi_env_free(hsm->nonleaf.hart_leaf_index);
+	rpmi_env_free(hsm->nonleaf.hart_leaf);
+	rpmi_env_free(hart_ids);
+	rpmi_env_free(hsm);
+	return NULL;
 }
 
 void rpmi_hsm_destroy(struct rpmi_hsm *hsm)
@@ -670,10 +1212,17 @@ void rpmi_hsm_destroy(struct rpmi_hsm *hsm)
 	}
 
 	if (!hsm->is_non_leaf) {
-		for (i = 0; i < hsm->leaf.hart_count; i++)
+		for (i = 0; i < hsm->hart_count; i++)
 			rpmi_env_free_lock(hsm->leaf.harts[i].lock);
+		rpmi_env_free(hsm->leaf.pending);
 		rpmi_env_free(hsm->leaf.harts);
+	} else {
+		rpmi_env_free(hsm->nonleaf.hart_leaf_index);
+		rpmi_env_free(hsm->nonleaf.hart_leaf);
+		rpmi_env_free((void *)hsm->hart_ids);
 	}
 
+	rpmi_env_free(hsm->suspend_type_map);
+	rpmi_env_free(hsm->id_map);
 	rpmi_env_free(hsm);
 }
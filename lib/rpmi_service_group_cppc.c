@@ -6,6 +6,7 @@
  */
 
 #include <librpmi.h>
+#include "librpmi_internal.h"
 
 #ifdef LIBRPMI_DEBUG
 #define DPRINTF(msg...)		rpmi_env_printf(msg)
@@ -74,6 +75,9 @@ struct rpmi_cppc_group {
 	const struct rpmi_cppc_platform_ops *ops;
 	void *ops_priv;
 
+	/** RPMI context to which the service group is added */
+	struct rpmi_context *cntx;
+
 	struct rpmi_service_group group;
 };
 
@@ -605,10 +609,10 @@ rpmi_cppc_sg_get_hart_list(struct rpmi_service_group *group,
 			   rpmi_uint8_t *response_data)
 {
 	enum rpmi_error status;
-	rpmi_uint32_t start_index, max_entries, hart_count, hart_id;
+	rpmi_uint32_t start_index, max_entries, hart_count;
 	struct rpmi_cppc_group *cppcgrp = group->priv;
 	rpmi_uint32_t *resp = (void *)response_data;
-	rpmi_uint32_t returned, remaining, i;
+	rpmi_uint32_t returned, remaining;
 
 	hart_count = rpmi_hsm_hart_count(cppcgrp->hsm);
 	max_entries = RPMI_MSG_DATA_SIZE(trans->slot_size) - (3 * sizeof(*resp));
@@ -619,10 +623,9 @@ rpmi_cppc_sg_get_hart_list(struct rpmi_service_group *group,
 	if (start_index <= hart_count) {
 		returned = max_entries < (hart_count - start_index) ?
 			max_entries : (hart_count - start_index);
-		for (i = 0; i < returned; i++) {
-			hart_id = rpmi_hsm_hart_index2id(cppcgrp->hsm, start_index + i);
-			resp[3 + i] = rpmi_to_xe32(trans->is_be, hart_id);
-		}
+		rpmi_to_xe32_array(trans->is_be, &resp[3],
+				   rpmi_hsm_hart_id_array(cppcgrp->hsm) + start_index,
+				   returned);
 		remaining = hart_count - (start_index + returned);
 		status = RPMI_SUCCESS;
 	} else {
@@ -659,6 +662,8 @@ static struct rpmi_service rpmi_cppc_services[RPMI_CPPC_SRV_ID_MAX] = {
 	[RPMI_CPPC_SRV_WRITE_REG] = {
 		.service_id = RPMI_CPPC_SRV_WRITE_REG,
 		.min_a2p_request_datalen = 16,
+		/* Hart ID and register ID */
+		.coalesce_key_len = 8,
 		.process_a2p_request = rpmi_cppc_sg_write_reg,
 	},
 	[RPMI_CPPC_SRV_GET_FAST_CHANNEL_REGION] = {
@@ -941,6 +946,30 @@ rpmi_service_group_cppc_create(struct rpmi_hsm *hsm,
 	return group;
 }
 
+void rpmi_service_group_cppc_set_context(struct rpmi_service_group *group,
+					 struct rpmi_context *cntx)
+{
+	struct rpmi_cppc_group *cppcgrp = group->priv;
+
+	cppcgrp->cntx = cntx;
+}
+
+enum rpmi_error rpmi_service_group_cppc_notify_fastchan(struct rpmi_service_group *group)
+{
+	struct rpmi_cppc_group *cppcgrp;
+
+	if (!group) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	cppcgrp = group->priv;
+	if (!cppcgrp->cntx)
+		return RPMI_ERR_NOTSUPP;
+
+	return rpmi_context_mark_group_pending(cppcgrp->cntx, group->servicegroup_id);
+}
+
 void rpmi_service_group_cppc_destroy(struct rpmi_service_group *group)
 {
 	struct rpmi_cppc_group *cppcgrp;
@@ -5,6 +5,7 @@
  */
 
 #include <librpmi.h>
+#include "librpmi_internal.h"
 
 #ifdef LIBRPMI_DEBUG
 #define DPRINTF(msg...)		rpmi_env_printf(msg)
@@ -102,6 +103,75 @@ static enum rpmi_error rpmi_hsm_sg_hart_suspend(struct rpmi_service_group *group
 	return RPMI_SUCCESS;
 }
 
+static enum rpmi_error rpmi_hsm_sg_hart_start_mask(struct rpmi_service_group *group,
+						   struct rpmi_service *service,
+						   struct rpmi_transport *trans,
+						   rpmi_uint16_t request_datalen,
+						   const rpmi_uint8_t *request_data,
+						   rpmi_uint16_t *response_datalen,
+						   rpmi_uint8_t *response_data)
+{
+	rpmi_uint32_t hart_id_base, hart_mask, failed_mask;
+	struct rpmi_hsm_group *sghsm = group->priv;
+	rpmi_uint32_t *resp = (void *)response_data;
+	rpmi_uint64_t start_addr;
+	enum rpmi_error status;
+
+	hart_id_base = rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[0]);
+	hart_mask = rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[1]);
+	start_addr = rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[3]);
+	start_addr = (start_addr << 32) |
+		     rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[2]);
+
+	status = rpmi_hsm_hart_start_mask(sghsm->hsm, hart_id_base, hart_mask,
+					  start_addr, &failed_mask);
+
+	*response_datalen = 2 * sizeof(*resp);
+	resp[0] = rpmi_to_xe32(trans->is_be, (rpmi_uint32_t)status);
+	resp[1] = rpmi_to_xe32(trans->is_be, failed_mask);
+
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error rpmi_hsm_sg_hart_suspend_mask(struct rpmi_service_group *group,
+						     struct rpmi_service *service,
+						     struct rpmi_transport *trans,
+						     rpmi_uint16_t request_datalen,
+						     const rpmi_uint8_t *request_data,
+						     rpmi_uint16_t *response_datalen,
+						     rpmi_uint8_t *response_data)
+{
+	rpmi_uint32_t hart_id_base, hart_mask, type, failed_mask;
+	const struct rpmi_hsm_suspend_type *suspend_type;
+	struct rpmi_hsm_group *sghsm = group->priv;
+	rpmi_uint32_t *resp = (void *)response_data;
+	rpmi_uint64_t resume_addr;
+	enum rpmi_error status;
+
+	hart_id_base = rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[0]);
+	hart_mask = rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[1]);
+	type = rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[2]);
+	resume_addr = rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[4]);
+	resume_addr = (resume_addr << 32) |
+		      rpmi_to_xe32(trans->is_be, ((const rpmi_uint32_t *)request_data)[3]);
+
+	suspend_type = rpmi_hsm_find_suspend_type(sghsm->hsm, type);
+	if (suspend_type) {
+		status = rpmi_hsm_hart_suspend_mask(sghsm->hsm, hart_id_base,
+						    hart_mask, suspend_type,
+						    resume_addr, &failed_mask);
+	} else {
+		status = RPMI_ERR_INVALID_PARAM;
+		failed_mask = hart_mask;
+	}
+
+	*response_datalen = 2 * sizeof(*resp);
+	resp[0] = rpmi_to_xe32(trans->is_be, (rpmi_uint32_t)status);
+	resp[1] = rpmi_to_xe32(trans->is_be, failed_mask);
+
+	return RPMI_SUCCESS;
+}
+
 static enum rpmi_error rpmi_hsm_sg_get_hart_status(struct rpmi_service_group *group,
 						   struct rpmi_service *service,
 						   struct rpmi_transport *trans,
@@ -139,10 +209,10 @@ static enum rpmi_error rpmi_hsm_sg_get_hart_list(struct rpmi_service_group *grou
 						 rpmi_uint16_t *response_datalen,
 						 rpmi_uint8_t *response_data)
 {
-	rpmi_uint32_t start_index, max_entries, hart_count, hart_id;
+	rpmi_uint32_t start_index, max_entries, hart_count;
 	struct rpmi_hsm_group *sghsm = group->priv;
 	rpmi_uint32_t *resp = (void *)response_data;
-	rpmi_uint32_t returned, remaining, i;
+	rpmi_uint32_t returned, remaining;
 	enum rpmi_error status;
 
 	hart_count = rpmi_hsm_hart_count(sghsm->hsm);
@@ -154,10 +224,9 @@ static enum rpmi_error rpmi_hsm_sg_get_hart_list(struct rpmi_service_group *grou
 	if (start_index <= hart_count) {
 		returned = max_entries < (hart_count - start_index) ?
 			   max_entries : (hart_count - start_index);
-		for (i = 0; i < returned; i++) {
-			hart_id = rpmi_hsm_hart_index2id(sghsm->hsm, start_index + i);
-			resp[3 + i] = rpmi_to_xe32(trans->is_be, hart_id);
-		}
+		rpmi_to_xe32_array(trans->is_be, &resp[3],
+				   rpmi_hsm_hart_id_array(sghsm->hsm) + start_index,
+				   returned);
 		remaining = hart_count - (start_index + returned);
 		status = RPMI_SUCCESS;
 	} else {
@@ -296,16 +365,37 @@ static struct rpmi_service rpmi_hsm_services[RPMI_HSM_SRV_ID_MAX] = {
 		.min_a2p_request_datalen = 4,
 		.process_a2p_request = rpmi_hsm_sg_get_suspend_info,
 	},
+	[RPMI_HSM_SRV_IMPL_HART_START_MASK] = {
+		.service_id = RPMI_HSM_SRV_IMPL_HART_START_MASK,
+		.min_a2p_request_datalen = 16,
+		.process_a2p_request = rpmi_hsm_sg_hart_start_mask,
+	},
+	[RPMI_HSM_SRV_IMPL_HART_SUSPEND_MASK] = {
+		.service_id = RPMI_HSM_SRV_IMPL_HART_SUSPEND_MASK,
+		.min_a2p_request_datalen = 20,
+		.process_a2p_request = rpmi_hsm_sg_hart_suspend_mask,
+	},
 };
 
 static enum rpmi_error rpmi_hsm_process_events(struct rpmi_service_group *group)
 {
 	struct rpmi_hsm_group *sghsm = group->priv;
 
-	rpmi_hsm_process_state_changes(sghsm->hsm);
+	/* Harts still in transition keep the group pending */
+	if (rpmi_hsm_process_state_changes(sghsm->hsm))
+		return RPMI_ERR_BUSY;
+
 	return RPMI_SUCCESS;
 }
 
+void rpmi_service_group_hsm_set_context(struct rpmi_service_group *group,
+					struct rpmi_context *cntx)
+{
+	struct rpmi_hsm_group *sghsm = group->priv;
+
+	rpmi_hsm_set_context(sghsm->hsm, cntx);
+}
+
 struct rpmi_service_group *rpmi_service_group_hsm_create(struct rpmi_hsm *hsm)
 {
 	struct rpmi_service_group *group;
@@ -334,6 +424,8 @@ struct rpmi_service_group *rpmi_service_group_hsm_create(struct rpmi_hsm *hsm)
 		RPMI_BASE_VERSION(RPMI_SPEC_VERSION_MAJOR, RPMI_SPEC_VERSION_MINOR);
 	/* Allowed only for M-mode RPMI context */
 	group->privilege_level_bitmap = RPMI_PRIVILEGE_M_MODE_MASK;
+	/* Latency critical so processed ahead of other requests */
+	group->priority = RPMI_SRVGRP_PRIORITY_HIGH;
 	group->max_service_id = RPMI_HSM_SRV_ID_MAX;
 	group->services = rpmi_hsm_services;
 	group->process_events = rpmi_hsm_process_events;
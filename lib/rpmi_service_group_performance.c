@@ -19,17 +19,6 @@
 #define DOORBELL_REG_MASK	GENMASK(2, 1)
 #define DOORBELL_SUPPORT_MASK	BIT(0)
 
-/* notification's event IDs */
-enum rpmi_perf_notification_event_ids {
-	/* performance power change */
-	RPMI_PERF_POWER_CHANGE = 1,
-	/* performance limit change */
-	RPMI_PERF_LIMIT_CHANGE = 2,
-	/* performance level change */
-	RPMI_PERF_LEVEL_CHANGE = 3,
-	RPMI_PERF_EVENT_MAX_IDX,
-};
-
 /* A performance domain instance */
 struct rpmi_perf {
 	/* Lock to invoke the platform operations to
@@ -54,6 +43,8 @@ struct rpmi_perf_group {
 	struct rpmi_perf_fc_memory_region *fc_memory_region;
 	/* Private data of platform perf operations */
 	void *ops_priv;
+	/* RPMI context the group is added to (NULL if none) */
+	struct rpmi_context *cntx;
 	struct rpmi_service_group group;
 };
 
@@ -64,6 +55,20 @@ rpmi_get_perf(struct rpmi_perf_group *perf_group, rpmi_uint32_t perf_id)
 	return &perf_group->perf_tree[perf_id];
 }
 
+/** Queue a perf notification event if the group is added to a context */
+static enum rpmi_error rpmi_perf_queue_event(struct rpmi_perf_group *perfgrp,
+					     rpmi_uint8_t event_id,
+					     const rpmi_uint32_t *data,
+					     rpmi_uint32_t num_words)
+{
+	if (!perfgrp->cntx)
+		return RPMI_SUCCESS;
+
+	return rpmi_context_queue_notification(perfgrp->cntx,
+					       RPMI_SRVGRP_PERFORMANCE,
+					       event_id, data, num_words);
+}
+
 static enum rpmi_error __rpmi_perf_get_attrs(struct rpmi_perf_group *perfgrp,
 					     rpmi_uint32_t perfid,
 					     struct rpmi_perf_attrs *attrs)
@@ -164,6 +169,10 @@ static enum rpmi_error __rpmi_perf_set_level(struct rpmi_perf_group *perfgrp,
 
 	rpmi_env_unlock(perf->lock);
 
+	if (!ret)
+		rpmi_service_group_perf_notify_level(&perfgrp->group, perf->id,
+						     perf_level);
+
 	return ret;
 }
 
@@ -204,6 +213,11 @@ static enum rpmi_error __rpmi_perf_set_limit(struct rpmi_perf_group *perfgrp,
 
 	rpmi_env_unlock(perf->lock);
 
+	if (!ret)
+		rpmi_service_group_perf_notify_limit(&perfgrp->group, perf->id,
+						     max_perf_limit,
+						     min_perf_limit);
+
 	return ret;
 }
 
@@ -709,6 +723,8 @@ static struct rpmi_service rpmi_perf_services[RPMI_PERF_SRV_ID_MAX] = {
 	[RPMI_PERF_SRV_SET_PERF_LEVEL] = {
 		.service_id = RPMI_PERF_SRV_SET_PERF_LEVEL,
 		.min_a2p_request_datalen = 8,
+		/* Performance domain ID */
+		.coalesce_key_len = 4,
 		.process_a2p_request = rpmi_perf_set_level,
 	},
 	[RPMI_PERF_SRV_GET_PERF_LIMIT] = {
@@ -719,6 +735,8 @@ static struct rpmi_service rpmi_perf_services[RPMI_PERF_SRV_ID_MAX] = {
 	[RPMI_PERF_SRV_SET_PERF_LIMIT] = {
 		.service_id = RPMI_PERF_SRV_SET_PERF_LIMIT,
 		.min_a2p_request_datalen = 12,
+		/* Performance domain ID */
+		.coalesce_key_len = 4,
 		.process_a2p_request = rpmi_perf_set_limit,
 	},
 	[RPMI_PERF_SRV_GET_FAST_CHANNEL_REGION] = {
@@ -794,12 +812,88 @@ rpmi_service_group_perf_create(rpmi_uint32_t perf_count,
 	group->privilege_level_bitmap = RPMI_PRIVILEGE_M_MODE_MASK | RPMI_PRIVILEGE_S_MODE_MASK;
 	group->max_service_id = RPMI_PERF_SRV_ID_MAX;
 	group->services = rpmi_perf_services;
+	group->notification_events = (1U << RPMI_PERF_POWER_CHANGE) |
+				     (1U << RPMI_PERF_LIMIT_CHANGE) |
+				     (1U << RPMI_PERF_LEVEL_CHANGE);
 	group->lock = rpmi_env_alloc_lock();
 	group->priv = perfgrp;
 
 	return group;
 }
 
+void rpmi_service_group_perf_set_context(struct rpmi_service_group *group,
+					 struct rpmi_context *cntx)
+{
+	struct rpmi_perf_group *perfgrp = group->priv;
+
+	perfgrp->cntx = cntx;
+}
+
+enum rpmi_error rpmi_service_group_perf_notify_power(struct rpmi_service_group *group,
+						     rpmi_uint32_t perf_id,
+						     rpmi_uint32_t power_uw)
+{
+	struct rpmi_perf_group *perfgrp;
+	rpmi_uint32_t ev_data[2];
+
+	if (!group) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	perfgrp = group->priv;
+	if (perf_id >= perfgrp->perf_count)
+		return RPMI_ERR_INVALID_PARAM;
+
+	ev_data[0] = perf_id;
+	ev_data[1] = power_uw;
+	return rpmi_perf_queue_event(perfgrp, RPMI_PERF_POWER_CHANGE, ev_data, 2);
+}
+
+enum rpmi_error rpmi_service_group_perf_notify_limit(struct rpmi_service_group *group,
+						     rpmi_uint32_t perf_id,
+						     rpmi_uint32_t max_perf_limit,
+						     rpmi_uint32_t min_perf_limit)
+{
+	struct rpmi_perf_group *perfgrp;
+	rpmi_uint32_t ev_data[3];
+
+	if (!group) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	perfgrp = group->priv;
+	if (perf_id >= perfgrp->perf_count)
+		return RPMI_ERR_INVALID_PARAM;
+
+	ev_data[0] = perf_id;
+	ev_data[1] = max_perf_limit;
+	ev_data[2] = min_perf_limit;
+	return rpmi_perf_queue_event(perfgrp, RPMI_PERF_LIMIT_CHANGE, ev_data, 3);
+}
+
+enum rpmi_error rpmi_service_group_perf_notify_level(struct rpmi_service_group *group,
+						     rpmi_uint32_t perf_id,
+						     rpmi_uint32_t perf_level)
+{
+	struct rpmi_perf_group *perfgrp;
+	rpmi_uint32_t ev_data[2];
+
+	if (!group) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	perfgrp = group->priv;
+	if (perf_id >= perfgrp->perf_count)
+		return RPMI_ERR_INVALID_PARAM;
+
+	ev_data[0] = perf_id;
+	ev_data[1] = perf_level;
+	return rpmi_perf_queue_event(perfgrp, RPMI_PERF_LEVEL_CHANGE, ev_data, 2);
+}
+
 void rpmi_service_group_perf_destroy(struct rpmi_service_group *group)
 {
 	rpmi_uint32_t perfid;
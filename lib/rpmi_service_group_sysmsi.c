@@ -5,6 +5,7 @@
  */
 
 #include <librpmi.h>
+#include "librpmi_internal.h"
 
 #ifdef LIBRPMI_DEBUG
 #define DPRINTF(msg...)		rpmi_env_printf(msg)
@@ -34,6 +35,9 @@ struct rpmi_sysmsi_group {
 	const struct rpmi_sysmsi_platform_ops *ops;
 	void *ops_priv;
 
+	/** RPMI context to which the service group is added */
+	struct rpmi_context *cntx;
+
 	struct rpmi_service_group group;
 };
 
@@ -321,9 +325,20 @@ enum rpmi_error rpmi_service_group_sysmsi_inject(struct rpmi_service_group *grou
 	ret = rpmi_sysmsi_process_events(group);
 	rpmi_env_unlock(group->lock);
 
+	if (sgmsi->cntx)
+		rpmi_context_mark_group_pending(sgmsi->cntx, group->servicegroup_id);
+
 	return ret;
 }
 
+void rpmi_service_group_sysmsi_set_context(struct rpmi_service_group *group,
+					   struct rpmi_context *cntx)
+{
+	struct rpmi_sysmsi_group *sgmsi = group->priv;
+
+	sgmsi->cntx = cntx;
+}
+
 enum rpmi_error rpmi_service_group_sysmsi_inject_p2a(struct rpmi_service_group *group)
 {
 	struct rpmi_sysmsi_group *sgmsi;
@@ -137,6 +137,8 @@ rpmi_service_group_sysreset_create(rpmi_uint32_t sysreset_type_count,
 		RPMI_BASE_VERSION(RPMI_SPEC_VERSION_MAJOR, RPMI_SPEC_VERSION_MINOR);
 	/* Allowed only for M-mode RPMI context */
 	group->privilege_level_bitmap = RPMI_PRIVILEGE_M_MODE_MASK;
+	/* Latency critical so processed ahead of other requests */
+	group->priority = RPMI_SRVGRP_PRIORITY_HIGH;
 	group->max_service_id = RPMI_SYSRST_SRV_ID_MAX;
 	group->services = rpmi_sysreset_services;
 	group->lock = rpmi_env_alloc_lock();
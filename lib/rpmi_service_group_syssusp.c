@@ -5,6 +5,7 @@
  */
 
 #include <librpmi.h>
+#include "librpmi_internal.h"
 
 #ifdef LIBRPMI_DEBUG
 #define DPRINTF(msg...)		rpmi_env_printf(msg)
@@ -32,6 +33,9 @@ struct rpmi_syssusp_group {
 	const struct rpmi_syssusp_platform_ops *ops;
 	void *ops_priv;
 
+	/** RPMI context the group is added to (NULL if none) */
+	struct rpmi_context *cntx;
+
 	struct rpmi_service_group group;
 };
 
@@ -138,6 +142,11 @@ static enum rpmi_error rpmi_syssusp_do_suspend(struct rpmi_service_group *group,
 	sgsusp->current_resume_addr = resume_addr;
 	sgsusp->current_state = RPMI_SYSSUSP_STATE_SUSPEND_PENDING;
 
+	/* Suspend is driven to completion by rpmi_syssusp_process_events() */
+	if (sgsusp->cntx)
+		rpmi_context_mark_group_pending(sgsusp->cntx,
+						group->servicegroup_id);
+
 done:
 	*response_datalen = sizeof(*resp);
 	resp[0] = rpmi_to_xe32(trans->is_be, (rpmi_uint32_t)status);
@@ -178,7 +187,8 @@ static enum rpmi_error rpmi_syssusp_process_events(struct rpmi_service_group *gr
 						sgsusp->current_syssusp_type,
 						sgsusp->current_resume_addr);
 		sgsusp->current_state = RPMI_SYSSUSP_STATE_SUSPENDED;
-		break;
+		/* Stay pending to poll for resume */
+		return RPMI_ERR_BUSY;
 	case RPMI_SYSSUSP_STATE_SUSPENDED:
 		if (!sgsusp->ops->system_suspend_can_resume(sgsusp->ops_priv,
 							    sgsusp->current_hart_index))
@@ -187,8 +197,12 @@ static enum rpmi_error rpmi_syssusp_process_events(struct rpmi_service_group *gr
 							sgsusp->current_hart_index,
 							sgsusp->current_syssusp_type,
 							sgsusp->current_resume_addr);
-		if (status)
-			return status;
+		if (status) {
+			DPRINTF("%s: system resume failed (error %d)\n",
+				__func__, status);
+			/* Still suspended so retry in the next call */
+			return RPMI_ERR_BUSY;
+		}
 		sgsusp->current_state = RPMI_SYSSUSP_STATE_RUNNING;
 		break;
 	case RPMI_SYSSUSP_STATE_RUNNING:
@@ -246,6 +260,8 @@ rpmi_service_group_syssusp_create(struct rpmi_hsm *hsm,
 		RPMI_BASE_VERSION(RPMI_SPEC_VERSION_MAJOR, RPMI_SPEC_VERSION_MINOR);
 	/* Allowed only for M-mode RPMI context */
 	group->privilege_level_bitmap = RPMI_PRIVILEGE_M_MODE_MASK;
+	/* Latency critical so processed ahead of other requests */
+	group->priority = RPMI_SRVGRP_PRIORITY_HIGH;
 	group->max_service_id = RPMI_SYSSUSP_SRV_ID_MAX;
 	group->services = rpmi_syssusp_services;
 	group->process_events = rpmi_syssusp_process_events;
@@ -255,6 +271,14 @@ rpmi_service_group_syssusp_create(struct rpmi_hsm *hsm,
 	return group;
 }
 
+void rpmi_service_group_syssusp_set_context(struct rpmi_service_group *group,
+					    struct rpmi_context *cntx)
+{
+	struct rpmi_syssusp_group *sgsusp = group->priv;
+
+	sgsusp->cntx = cntx;
+}
+
 void rpmi_service_group_syssusp_destroy(struct rpmi_service_group *group)
 {
 	if (!group) {
@@ -97,6 +97,26 @@ rpmi_uint32_t rpmi_shmem_size(struct rpmi_shmem *shmem)
 	return (shmem) ? shmem->size : 0;
 }
 
+void *rpmi_shmem_direct_ptr(struct rpmi_shmem *shmem, rpmi_uint32_t offset,
+			    rpmi_uint32_t len)
+{
+	if (!shmem) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return NULL;
+	}
+	if ((offset + len) > shmem->size) {
+		DPRINTF("%s: %s: invalid offset 0x%x or len 0x%x\n",
+			__func__, shmem->name, offset, len);
+		return NULL;
+	}
+
+	/* Only simple operations access the shared memory directly */
+	if (shmem->ops != &rpmi_shmem_simple_ops)
+		return NULL;
+
+	return (void *)(unsigned long)(shmem->base + offset);
+}
+
 enum rpmi_error rpmi_shmem_read(struct rpmi_shmem *shmem, rpmi_uint32_t offset,
 				void *in, rpmi_uint32_t len)
 {
@@ -12,6 +12,63 @@
 #define DPRINTF(msg...)
 #endif
 
+/* Header is not rewritten at all if transport endianness is native */
+static inline void __rpmi_transport_convert_header(struct rpmi_transport *trans,
+						   struct rpmi_message_header *mhdr)
+{
+	if (rpmi_xe_is_native(trans->is_be))
+		return;
+
+	mhdr->servicegroup_id = rpmi_to_xe16(trans->is_be, mhdr->servicegroup_id);
+	mhdr->datalen = rpmi_to_xe16(trans->is_be, mhdr->datalen);
+	mhdr->token = rpmi_to_xe16(trans->is_be, mhdr->token);
+}
+
+static inline void __rpmi_transport_convert_batch(struct rpmi_transport *trans,
+						  struct rpmi_message *msgs,
+						  rpmi_uint32_t count)
+{
+	rpmi_uint32_t i;
+
+	if (rpmi_xe_is_native(trans->is_be))
+		return;
+
+	for (i = 0; i < count; i++)
+		__rpmi_transport_convert_header(trans,
+				&rpmi_transport_batch_msg(trans, msgs, i)->header);
+}
+
+/* Transport lock is not needed for single producer single consumer queues */
+static inline void __rpmi_transport_lock(struct rpmi_transport *trans)
+{
+	if (!trans->is_spsc)
+		rpmi_env_lock(trans->lock);
+}
+
+static inline void __rpmi_transport_unlock(struct rpmi_transport *trans)
+{
+	if (!trans->is_spsc)
+		rpmi_env_unlock(trans->lock);
+}
+
+static enum rpmi_error __rpmi_transport_check_queue(struct rpmi_transport *trans,
+						    enum rpmi_queue_type qtype,
+						    const char *func)
+{
+	if (qtype >= RPMI_QUEUE_MAX) {
+		DPRINTF("%s: %s: invalid qtype %d\n", func, trans->name, qtype);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	if (!trans->is_p2a_channel && qtype >= RPMI_QUEUE_P2A_REQ) {
+		DPRINTF("%s: %s: p2a channel not available, invalid qtype %d\n",
+			func, trans->name, qtype);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	return RPMI_SUCCESS;
+}
+
 static inline rpmi_bool_t __rpmi_transport_is_empty(struct rpmi_transport *trans,
 						    enum rpmi_queue_type qtype)
 {
@@ -33,9 +90,9 @@ rpmi_bool_t rpmi_transport_is_empty(struct rpmi_transport *trans,
 		return false;
 	}
 
-	rpmi_env_lock(trans->lock);
+	__rpmi_transport_lock(trans);
 	ret = __rpmi_transport_is_empty(trans, qtype);
-	rpmi_env_unlock(trans->lock);
+	__rpmi_transport_unlock(trans);
 
 	return ret;
 }
@@ -61,9 +118,9 @@ rpmi_bool_t rpmi_transport_is_full(struct rpmi_transport *trans,
 		return true;
 	}
 
-	rpmi_env_lock(trans->lock);
+	__rpmi_transport_lock(trans);
 	ret = __rpmi_transport_is_full(trans, qtype);
-	rpmi_env_unlock(trans->lock);
+	__rpmi_transport_unlock(trans);
 
 	return ret;
 }
@@ -72,7 +129,6 @@ enum rpmi_error rpmi_transport_enqueue(struct rpmi_transport *trans,
 				      enum rpmi_queue_type qtype,
 				      struct rpmi_message *msg)
 {
-	struct rpmi_message_header *mhdr;
 	enum rpmi_error rc;
 
 	if (!trans || !msg) {
@@ -80,16 +136,9 @@ enum rpmi_error rpmi_transport_enqueue(struct rpmi_transport *trans,
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	if (qtype >= RPMI_QUEUE_MAX) {
-		DPRINTF("%s: %s: invalid qtype %d\n", __func__, trans->name, qtype);
-		return RPMI_ERR_INVALID_PARAM;
-	}
-
-	if (!trans->is_p2a_channel && qtype >= RPMI_QUEUE_P2A_REQ) {
-		DPRINTF("%s: %s: p2a channel not available, invalid qtype %d\n",
-			__func__, trans->name, qtype);
-		return RPMI_ERR_INVALID_PARAM;
-	}
+	rc = __rpmi_transport_check_queue(trans, qtype, __func__);
+	if (rc)
+		return rc;
 
 	if (!trans->enqueue) {
 		DPRINTF("%s: %s: enqueue operation not supported for qtype %d\n",
@@ -98,25 +147,17 @@ enum rpmi_error rpmi_transport_enqueue(struct rpmi_transport *trans,
 	}
 
 	/* Convert header fields to match transport endianness */
-	mhdr = &msg->header;
-	mhdr->servicegroup_id = rpmi_to_xe32(trans->is_be, mhdr->servicegroup_id);
-	mhdr->datalen = rpmi_to_xe32(trans->is_be, mhdr->datalen);
-	mhdr->token = rpmi_to_xe16(trans->is_be, mhdr->token);
+	__rpmi_transport_convert_header(trans, &msg->header);
 
-	/* Enqueue the message */
-	rpmi_env_lock(trans->lock);
-	if (__rpmi_transport_is_full(trans, qtype)) {
-		DPRINTF("%s: %s: qtype %d is full\n", __func__, trans->name, qtype);
-		rpmi_env_unlock(trans->lock);
-		return RPMI_ERR_IO;
-	}
+	/* Enqueue the message (fails with RPMI_ERR_IO if queue is full) */
+	__rpmi_transport_lock(trans);
 	rc = trans->enqueue(trans, qtype, msg);
-	rpmi_env_unlock(trans->lock);
+	__rpmi_transport_unlock(trans);
+	if (rc == RPMI_ERR_IO)
+		DPRINTF("%s: %s: qtype %d is full\n", __func__, trans->name, qtype);
 
 	/* Reverse the endian conversion of header fields */
-	mhdr->servicegroup_id = rpmi_to_xe32(trans->is_be, mhdr->servicegroup_id);
-	mhdr->datalen = rpmi_to_xe16(trans->is_be, mhdr->datalen);
-	mhdr->token = rpmi_to_xe16(trans->is_be, mhdr->token);
+	__rpmi_transport_convert_header(trans, &msg->header);
 
 	return rc;
 }
@@ -125,7 +166,6 @@ enum rpmi_error rpmi_transport_dequeue(struct rpmi_transport *trans,
 				       enum rpmi_queue_type qtype,
 				       struct rpmi_message *out_msg)
 {
-	struct rpmi_message_header *mhdr;
 	enum rpmi_error rc;
 
 	if (!trans || !out_msg) {
@@ -133,41 +173,197 @@ enum rpmi_error rpmi_transport_dequeue(struct rpmi_transport *trans,
 		return RPMI_ERR_INVALID_PARAM;
 	}
 
-	if (qtype >= RPMI_QUEUE_MAX) {
-		DPRINTF("%s: %s: invalid qtype %d\n", __func__, trans->name, qtype);
-		return RPMI_ERR_INVALID_PARAM;
+	rc = __rpmi_transport_check_queue(trans, qtype, __func__);
+	if (rc)
+		return rc;
+
+	if (!trans->dequeue) {
+		DPRINTF("%s: %s: dequeue operation not supported for qtype %d\n",
+			__func__, trans->name, qtype);
+		return RPMI_ERR_NOTSUPP;
 	}
 
-	if (!trans->is_p2a_channel && qtype >= RPMI_QUEUE_P2A_REQ) {
-		DPRINTF("%s: %s: p2a channel not available, invalid qtype %d\n",
+	/* Dequeue the message (fails with RPMI_ERR_IO if queue is empty) */
+	__rpmi_transport_lock(trans);
+	rc = trans->dequeue(trans, qtype, out_msg);
+	__rpmi_transport_unlock(trans);
+	if (rc == RPMI_ERR_IO)
+		DPRINTF("%s: %s: qtype %d is empty\n", __func__, trans->name, qtype);
+
+	/* Convert header fields to native endianness */
+	if (!rc)
+		__rpmi_transport_convert_header(trans, &out_msg->header);
+
+	return rc;
+}
+
+rpmi_uint32_t rpmi_transport_enqueue_batch(struct rpmi_transport *trans,
+					   enum rpmi_queue_type qtype,
+					   struct rpmi_message *msgs,
+					   rpmi_uint32_t count)
+{
+	rpmi_uint32_t ret = 0;
+
+	if (!trans || !msgs) {
+		DPRINTF("%s: NULL transport or message pointer\n", __func__);
+		return 0;
+	}
+
+	if (__rpmi_transport_check_queue(trans, qtype, __func__))
+		return 0;
+
+	if (!trans->enqueue_batch && !trans->enqueue) {
+		DPRINTF("%s: %s: enqueue operation not supported for qtype %d\n",
 			__func__, trans->name, qtype);
-		return RPMI_ERR_INVALID_PARAM;
+		return 0;
 	}
 
-	if (!trans->dequeue) {
+	/* Convert header fields to match transport endianness */
+	__rpmi_transport_convert_batch(trans, msgs, count);
+
+	/* Enqueue the messages */
+	__rpmi_transport_lock(trans);
+	if (trans->enqueue_batch) {
+		ret = trans->enqueue_batch(trans, qtype, msgs, count);
+	} else {
+		while (ret < count) {
+			if (trans->enqueue(trans, qtype,
+					   rpmi_transport_batch_msg(trans, msgs, ret)))
+				break;
+			ret++;
+		}
+	}
+	__rpmi_transport_unlock(trans);
+
+	/* Reverse the endian conversion of header fields */
+	__rpmi_transport_convert_batch(trans, msgs, count);
+
+	return ret;
+}
+
+rpmi_uint32_t rpmi_transport_dequeue_batch(struct rpmi_transport *trans,
+					   enum rpmi_queue_type qtype,
+					   struct rpmi_message *out_msgs,
+					   rpmi_uint32_t max_count)
+{
+	rpmi_uint32_t ret = 0;
+
+	if (!trans || !out_msgs) {
+		DPRINTF("%s: NULL transport or message pointer\n", __func__);
+		return 0;
+	}
+
+	if (__rpmi_transport_check_queue(trans, qtype, __func__))
+		return 0;
+
+	if (!trans->dequeue_batch && !trans->dequeue) {
 		DPRINTF("%s: %s: dequeue operation not supported for qtype %d\n",
 			__func__, trans->name, qtype);
-		return RPMI_ERR_NOTSUPP;
+		return 0;
 	}
 
-	rpmi_env_lock(trans->lock);
-
-	/* Dequeue the message */
-	if (__rpmi_transport_is_empty(trans, qtype)) {
-		DPRINTF("%s: %s: qtype %d is empty\n", __func__, trans->name, qtype);
-		rpmi_env_unlock(trans->lock);
-		return RPMI_ERR_IO;
+	/* Dequeue the messages */
+	__rpmi_transport_lock(trans);
+	if (trans->dequeue_batch) {
+		ret = trans->dequeue_batch(trans, qtype, out_msgs, max_count);
+	} else {
+		while (ret < max_count) {
+			if (trans->dequeue(trans, qtype,
+					   rpmi_transport_batch_msg(trans, out_msgs, ret)))
+				break;
+			ret++;
+		}
 	}
-	rc = trans->dequeue(trans, qtype, out_msg);
-	rpmi_env_unlock(trans->lock);
+	__rpmi_transport_unlock(trans);
 
 	/* Convert header fields to native endianness */
-	if (!rc) {
-		mhdr = &out_msg->header;
-		mhdr->servicegroup_id = rpmi_to_xe32(trans->is_be, mhdr->servicegroup_id);
-		mhdr->datalen = rpmi_to_xe16(trans->is_be, mhdr->datalen);
-		mhdr->token = rpmi_to_xe16(trans->is_be, mhdr->token);
+	__rpmi_transport_convert_batch(trans, out_msgs, ret);
+
+	return ret;
+}
+
+struct rpmi_message *rpmi_transport_peek_slot(struct rpmi_transport *trans,
+					      enum rpmi_queue_type qtype,
+					      rpmi_uint32_t index)
+{
+	struct rpmi_message *slot;
+
+	if (!trans) {
+		DPRINTF("%s: NULL transport pointer\n", __func__);
+		return NULL;
+	}
+
+	if (__rpmi_transport_check_queue(trans, qtype, __func__))
+		return NULL;
+
+	if (!trans->peek_slot) {
+		DPRINTF("%s: %s: peek operation not supported for qtype %d\n",
+			__func__, trans->name, qtype);
+		return NULL;
+	}
+
+	__rpmi_transport_lock(trans);
+	slot = trans->peek_slot(trans, qtype, index);
+	__rpmi_transport_unlock(trans);
+
+	return slot;
+}
+
+enum rpmi_error rpmi_transport_commit_slot(struct rpmi_transport *trans,
+					   enum rpmi_queue_type qtype,
+					   rpmi_uint32_t count)
+{
+	enum rpmi_error rc;
+
+	if (!trans) {
+		DPRINTF("%s: NULL transport pointer\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	rc = __rpmi_transport_check_queue(trans, qtype, __func__);
+	if (rc)
+		return rc;
+
+	if (!trans->commit_slot) {
+		DPRINTF("%s: %s: commit operation not supported for qtype %d\n",
+			__func__, trans->name, qtype);
+		return RPMI_ERR_NOTSUPP;
 	}
 
+	if (!count)
+		return RPMI_SUCCESS;
+
+	__rpmi_transport_lock(trans);
+	rc = trans->commit_slot(trans, qtype, count);
+	__rpmi_transport_unlock(trans);
+
 	return rc;
 }
+
+enum rpmi_error rpmi_transport_get_queue_stats(struct rpmi_transport *trans,
+					enum rpmi_queue_type qtype,
+					struct rpmi_transport_queue_stats *stats)
+{
+	enum rpmi_error rc;
+
+	if (!trans || !stats) {
+		DPRINTF("%s: invalid parameters\n", __func__);
+		return RPMI_ERR_INVALID_PARAM;
+	}
+
+	rc = __rpmi_transport_check_queue(trans, qtype, __func__);
+	if (rc)
+		return rc;
+
+	if (!trans->get_queue_stats) {
+		DPRINTF("%s: %s: queue statistics not supported for qtype %d\n",
+			__func__, trans->name, qtype);
+		return RPMI_ERR_NOTSUPP;
+	}
+
+	__rpmi_transport_lock(trans);
+	trans->get_queue_stats(trans, qtype, stats);
+	__rpmi_transport_unlock(trans);
+
+	return RPMI_SUCCESS;
+}
@@ -5,6 +5,7 @@
  */
 
 #include <librpmi.h>
+#include "librpmi_internal.h"
 
 #ifdef LIBRPMI_DEBUG
 #define DPRINTF(msg...)		rpmi_env_printf(msg)
@@ -17,6 +18,20 @@ struct rpmi_transport_shmem_queue {
 	rpmi_uint32_t queue_size;
 	rpmi_uint32_t queue_base;
 	rpmi_uint32_t data_slots;
+	/* Power-of-two layout with free-running indices */
+	rpmi_bool_t is_pow2;
+	/* Mask to get slot position from index (power-of-two layout) */
+	rpmi_uint32_t slot_mask;
+	/* Local copy of head index owned by the dequeuing side */
+	rpmi_uint32_t head;
+	/* Local copy of tail index owned by the enqueuing side */
+	rpmi_uint32_t tail;
+	/* Tail index last read from shared memory by the dequeuing side */
+	rpmi_uint32_t peer_tail;
+	/* Head index last read from shared memory by the enqueuing side */
+	rpmi_uint32_t peer_head;
+	/* Occupancy and backpressure statistics */
+	struct rpmi_transport_queue_stats stats;
 };
 
 struct rpmi_transport_shmem {
@@ -26,103 +41,281 @@ struct rpmi_transport_shmem {
 	struct rpmi_transport trans;
 };
 
-static rpmi_bool_t shmem_is_empty(struct rpmi_transport *trans,
-				  enum rpmi_queue_type qtype)
+static enum rpmi_error shmem_read_index(struct rpmi_transport *trans,
+					enum rpmi_queue_type qtype,
+					rpmi_bool_t is_tail, rpmi_uint32_t *idx)
 {
 	struct rpmi_transport_shmem *shtrans = trans->priv;
-	struct rpmi_shmem *shmem = shtrans->shmem;
 	rpmi_uint32_t queue_base = shtrans->queues[qtype].queue_base;
-	rpmi_uint32_t headidx, tailidx;
+	rpmi_uint32_t val;
 	int rc;
 
-	rc = rpmi_shmem_read(shmem, queue_base, &headidx, sizeof(headidx));
+	rc = rpmi_shmem_read(shtrans->shmem,
+			     queue_base + (is_tail ? trans->slot_size : 0),
+			     &val, sizeof(val));
 	if (rc) {
-		DPRINTF("%s: %s: failed to read head index of qtype %d\n",
-			__func__, trans->name, qtype);
-		return false;
+		DPRINTF("%s: %s: failed to read %s index of qtype %d\n",
+			__func__, trans->name, is_tail ? "tail" : "head", qtype);
+		return RPMI_ERR_FAILED;
 	}
-	headidx = rpmi_to_le32(headidx);
 
-	rc = rpmi_shmem_read(shmem, queue_base + trans->slot_size,
-			     &tailidx, sizeof(tailidx));
-	if (rc) {
-		DPRINTF("%s: %s: failed to read tail index of qtype %d\n",
-			__func__, trans->name, qtype);
-		return false;
-	}
-	tailidx = rpmi_to_le32(tailidx);
+	*idx = rpmi_to_le32(val);
 
-	return (headidx == tailidx) ? true : false;
+	/* Slot accesses must not happen before the index is observed */
+	rpmi_env_barrier_acquire();
+
+	return RPMI_SUCCESS;
 }
 
-static rpmi_bool_t shmem_is_full(struct rpmi_transport *trans,
-				 enum rpmi_queue_type qtype)
+static enum rpmi_error shmem_write_index(struct rpmi_transport *trans,
+					 enum rpmi_queue_type qtype,
+					 rpmi_bool_t is_tail, rpmi_uint32_t idx)
 {
 	struct rpmi_transport_shmem *shtrans = trans->priv;
 	rpmi_uint32_t queue_base = shtrans->queues[qtype].queue_base;
-	rpmi_uint32_t data_slots = shtrans->queues[qtype].data_slots;
-	struct rpmi_shmem *shmem = shtrans->shmem;
-	rpmi_uint32_t headidx, tailidx;
+	rpmi_uint32_t val = rpmi_to_le32(idx);
 	int rc;
 
-	rc = rpmi_shmem_read(shmem, queue_base, &headidx, sizeof(headidx));
+	/* Slot accesses must complete before the index is published */
+	rpmi_env_barrier_release();
+
+	rc = rpmi_shmem_write(shtrans->shmem,
+			      queue_base + (is_tail ? trans->slot_size : 0),
+			      &val, sizeof(val));
 	if (rc) {
-		DPRINTF("%s: %s: failed to read head index of qtype %d\n",
-			__func__, trans->name, qtype);
-		return false;
+		DPRINTF("%s: %s: failed to write %s index for qtype %d\n",
+			__func__, trans->name, is_tail ? "tail" : "head", qtype);
+		return RPMI_ERR_FAILED;
 	}
-	headidx = rpmi_to_le32(headidx);
 
-	rc = rpmi_shmem_read(shmem, queue_base + trans->slot_size,
-			     &tailidx, sizeof(tailidx));
-	if (rc) {
-		DPRINTF("%s: %s: failed to read tail index of qtype %d\n",
-			__func__, trans->name, qtype);
+	return RPMI_SUCCESS;
+}
+
+/*
+ * The spec layout keeps indices in [0, data_slots) and one slot always
+ * free to distinguish full from empty. The power-of-two layout uses
+ * free-running indices so all data slots are usable and wrap is a mask.
+ */
+static inline rpmi_uint32_t shmem_slot_pos(struct rpmi_transport_shmem_queue *shqueue,
+					   rpmi_uint32_t idx)
+{
+	return (shqueue->is_pow2) ? (idx & shqueue->slot_mask) : idx;
+}
+
+static inline rpmi_uint32_t shmem_index_add(struct rpmi_transport_shmem_queue *shqueue,
+					    rpmi_uint32_t idx, rpmi_uint32_t count)
+{
+	if (shqueue->is_pow2)
+		return idx + count;
+
+	/* Both idx and count are at most data_slots so no division needed */
+	idx += count;
+	return (idx >= shqueue->data_slots) ? (idx - shqueue->data_slots) : idx;
+}
+
+static inline rpmi_uint32_t shmem_capacity(struct rpmi_transport_shmem_queue *shqueue)
+{
+	return (shqueue->is_pow2) ? shqueue->data_slots : (shqueue->data_slots - 1);
+}
+
+static rpmi_uint32_t shmem_used_slots(struct rpmi_transport_shmem_queue *shqueue,
+				      rpmi_uint32_t headidx, rpmi_uint32_t tailidx)
+{
+	if (shqueue->is_pow2)
+		return tailidx - headidx;
+
+	return (tailidx >= headidx) ? (tailidx - headidx) :
+				      (tailidx + shqueue->data_slots - headidx);
+}
+
+static inline void shmem_update_depth(struct rpmi_transport_shmem_queue *shqueue,
+				      rpmi_uint32_t depth)
+{
+	shqueue->stats.depth = depth;
+	if (depth > shqueue->stats.high_water_mark)
+		shqueue->stats.high_water_mark = depth;
+}
+
+/* Check an index written by the peer before trusting it */
+static rpmi_bool_t shmem_peer_index_valid(struct rpmi_transport_shmem_queue *shqueue,
+					  rpmi_uint32_t headidx, rpmi_uint32_t tailidx)
+{
+	if (!shqueue->is_pow2 &&
+	    (headidx >= shqueue->data_slots || tailidx >= shqueue->data_slots))
 		return false;
+
+	return (shmem_used_slots(shqueue, headidx, tailidx) <= shmem_capacity(shqueue)) ?
+		true : false;
+}
+
+/*
+ * Number of pending messages as seen by the dequeuing side. The tail index
+ * owned by the enqueuing side is read from shared memory only when the
+ * cached view says the queue is empty.
+ */
+static rpmi_uint32_t shmem_pending_slots(struct rpmi_transport *trans,
+					 enum rpmi_queue_type qtype)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+	rpmi_uint32_t tailidx;
+
+	if (shqueue->head == shqueue->peer_tail) {
+		if (shmem_read_index(trans, qtype, true, &tailidx))
+			return 0;
+		if (!shmem_peer_index_valid(shqueue, shqueue->head, tailidx)) {
+			DPRINTF("%s: %s: invalid tail index %d for qtype %d\n",
+				__func__, trans->name, tailidx, qtype);
+			return 0;
+		}
+		shqueue->peer_tail = tailidx;
+		shmem_update_depth(shqueue,
+				   shmem_used_slots(shqueue, shqueue->head, tailidx));
 	}
-	tailidx = rpmi_to_le32(tailidx);
 
-	return (rpmi_env_mod32(tailidx + 1, data_slots) == headidx) ? true : false;
+	return shmem_used_slots(shqueue, shqueue->head, shqueue->peer_tail);
 }
 
-static enum rpmi_error shmem_enqueue(struct rpmi_transport *trans,
-				     enum rpmi_queue_type qtype,
-				     const struct rpmi_message *msg)
+/*
+ * Number of free slots as seen by the enqueuing side. The head index owned
+ * by the dequeuing side is read from shared memory only when the cached
+ * view says the queue is full (or cannot fit the wanted number of slots
+ * so that a batch is not split into multiple publications).
+ */
+static rpmi_uint32_t shmem_free_slots(struct rpmi_transport *trans,
+				      enum rpmi_queue_type qtype,
+				      rpmi_uint32_t want)
 {
 	struct rpmi_transport_shmem *shtrans = trans->priv;
-	rpmi_uint32_t queue_base = shtrans->queues[qtype].queue_base;
-	rpmi_uint32_t data_slots = shtrans->queues[qtype].data_slots;
-	struct rpmi_shmem *shmem = shtrans->shmem;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+	rpmi_uint32_t headidx, free;
+
+	free = shmem_capacity(shqueue) -
+	       shmem_used_slots(shqueue, shqueue->peer_head, shqueue->tail);
+	if (free < want) {
+		if (shmem_read_index(trans, qtype, false, &headidx))
+			return 0;
+		if (!shmem_peer_index_valid(shqueue, headidx, shqueue->tail)) {
+			DPRINTF("%s: %s: invalid head index %d for qtype %d\n",
+				__func__, trans->name, headidx, qtype);
+			return 0;
+		}
+		shqueue->peer_head = headidx;
+		free = shmem_capacity(shqueue) -
+		       shmem_used_slots(shqueue, shqueue->peer_head, shqueue->tail);
+		shmem_update_depth(shqueue, shmem_capacity(shqueue) - free);
+	}
+
+	return free;
+}
+
+static enum rpmi_error shmem_advance_head(struct rpmi_transport *trans,
+					  enum rpmi_queue_type qtype,
+					  rpmi_uint32_t count)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+	rpmi_uint32_t headidx;
+	enum rpmi_error rc;
+
+	headidx = shmem_index_add(shqueue, shqueue->head, count);
+	rc = shmem_write_index(trans, qtype, false, headidx);
+	if (!rc) {
+		shqueue->head = headidx;
+		shqueue->stats.dequeue_count += count;
+		shmem_update_depth(shqueue,
+				   shmem_used_slots(shqueue, headidx, shqueue->peer_tail));
+	}
+
+	return rc;
+}
+
+static enum rpmi_error shmem_advance_tail(struct rpmi_transport *trans,
+					  enum rpmi_queue_type qtype,
+					  rpmi_uint32_t count)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
 	rpmi_uint32_t tailidx;
+	enum rpmi_error rc;
+
+	tailidx = shmem_index_add(shqueue, shqueue->tail, count);
+	rc = shmem_write_index(trans, qtype, true, tailidx);
+	if (!rc) {
+		shqueue->tail = tailidx;
+		shqueue->stats.enqueue_count += count;
+		shmem_update_depth(shqueue,
+				   shmem_used_slots(shqueue, shqueue->peer_head, tailidx));
+	}
+
+	return rc;
+}
+
+static enum rpmi_error shmem_copy_slots(struct rpmi_transport *trans,
+					enum rpmi_queue_type qtype,
+					rpmi_uint32_t idx, rpmi_uint32_t count,
+					void *buf, rpmi_bool_t is_write)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+	rpmi_uint32_t chunk, offset;
+	rpmi_uint8_t *ptr = buf;
 	int rc;
 
-	rc = rpmi_shmem_read(shmem, queue_base + trans->slot_size,
-			     &tailidx, sizeof(tailidx));
-	if (rc) {
-		DPRINTF("%s: %s: failed to read tail index of qtype %d\n",
-			__func__, trans->name, qtype);
-		return RPMI_ERR_FAILED;
+	/* Copy in at most two contiguous chunks (before and after wrap) */
+	idx = shmem_slot_pos(shqueue, idx);
+	while (count) {
+		chunk = RPMI_MIN(count, shqueue->data_slots - idx);
+		offset = shqueue->queue_base + ((idx + 2) * trans->slot_size);
+		if (is_write)
+			rc = rpmi_shmem_write(shtrans->shmem, offset, ptr,
+					      chunk * trans->slot_size);
+		else
+			rc = rpmi_shmem_read(shtrans->shmem, offset, ptr,
+					     chunk * trans->slot_size);
+		if (rc) {
+			DPRINTF("%s: %s: failed to %s %d slots at index %d for qtype %d\n",
+				__func__, trans->name, is_write ? "write" : "read",
+				chunk, idx, qtype);
+			return RPMI_ERR_FAILED;
+		}
+
+		ptr += chunk * trans->slot_size;
+		count -= chunk;
+		idx = 0;
 	}
-	tailidx = rpmi_to_le32(tailidx);
 
-	rc = rpmi_shmem_write(shmem, queue_base + ((tailidx + 2) * trans->slot_size),
-			      msg, trans->slot_size);
-	if (rc) {
-		DPRINTF("%s: %s: failed to write message at tailidx %d for qtype %d\n",
-			__func__, trans->name, tailidx, qtype);
-		return RPMI_ERR_FAILED;
+	return RPMI_SUCCESS;
+}
+
+static rpmi_bool_t shmem_is_empty(struct rpmi_transport *trans,
+				  enum rpmi_queue_type qtype)
+{
+	return (shmem_pending_slots(trans, qtype)) ? false : true;
+}
+
+static rpmi_bool_t shmem_is_full(struct rpmi_transport *trans,
+				 enum rpmi_queue_type qtype)
+{
+	return (shmem_free_slots(trans, qtype, 1)) ? false : true;
+}
+
+static enum rpmi_error shmem_enqueue(struct rpmi_transport *trans,
+				     enum rpmi_queue_type qtype,
+				     const struct rpmi_message *msg)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+
+	if (!shmem_free_slots(trans, qtype, 1)) {
+		shqueue->stats.full_count++;
+		return RPMI_ERR_IO;
 	}
 
-	tailidx = rpmi_to_le32(rpmi_env_mod32(tailidx + 1, data_slots));
-	rc = rpmi_shmem_write(shmem, queue_base + trans->slot_size,
-			      &tailidx, sizeof(tailidx));
-	if (rc) {
-		DPRINTF("%s: %s: failed to write tail index for qtype %d\n",
-			__func__, trans->name, qtype);
+	if (shmem_copy_slots(trans, qtype, shqueue->tail, 1, (void *)msg, true))
 		return RPMI_ERR_FAILED;
-	}
 
-	return 0;
+	return shmem_advance_tail(trans, qtype, 1);
 }
 
 static enum rpmi_error shmem_dequeue(struct rpmi_transport *trans,
@@ -130,45 +323,138 @@ static enum rpmi_error shmem_dequeue(struct rpmi_transport *trans,
 				     struct rpmi_message *out_msg)
 {
 	struct rpmi_transport_shmem *shtrans = trans->priv;
-	rpmi_uint32_t queue_base = shtrans->queues[qtype].queue_base;
-	rpmi_uint32_t data_slots = shtrans->queues[qtype].data_slots;
-	struct rpmi_shmem *shmem = shtrans->shmem;
-	rpmi_uint32_t headidx;
-	int rc;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
 
-	rc = rpmi_shmem_read(shmem, queue_base, &headidx, sizeof(headidx));
-	if (rc) {
-		DPRINTF("%s: %s: failed to read head index of qtype %d\n",
-			__func__, trans->name, qtype);
-		return false;
+	if (!shmem_pending_slots(trans, qtype)) {
+		shqueue->stats.empty_count++;
+		return RPMI_ERR_IO;
 	}
-	headidx = rpmi_to_le32(headidx);
 
-	rc = rpmi_shmem_read(shmem, queue_base + ((headidx + 2) * trans->slot_size),
-			     out_msg, trans->slot_size);
-	if (rc) {
-		DPRINTF("%s: %s: failed to read message at headidx %d for qtype %d\n",
-			__func__, trans->name, headidx, qtype);
+	if (shmem_copy_slots(trans, qtype, shqueue->head, 1, out_msg, false))
 		return RPMI_ERR_FAILED;
+
+	return shmem_advance_head(trans, qtype, 1);
+}
+
+static rpmi_uint32_t shmem_enqueue_batch(struct rpmi_transport *trans,
+					 enum rpmi_queue_type qtype,
+					 const struct rpmi_message *msgs,
+					 rpmi_uint32_t count)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+
+	count = RPMI_MIN(count, shmem_free_slots(trans, qtype, count));
+	if (!count) {
+		shqueue->stats.full_count++;
+		return 0;
 	}
 
-	headidx = rpmi_to_le32(rpmi_env_mod32(headidx + 1, data_slots));
-	rc = rpmi_shmem_write(shmem, queue_base,
-			      &headidx, sizeof(headidx));
-	if (rc) {
-		DPRINTF("%s: %s: failed to write head index for qtype %d\n",
-			__func__, trans->name, qtype);
-		return RPMI_ERR_FAILED;
+	if (shmem_copy_slots(trans, qtype, shqueue->tail, count, (void *)msgs, true))
+		return 0;
+
+	if (shmem_advance_tail(trans, qtype, count))
+		return 0;
+
+	return count;
+}
+
+static rpmi_uint32_t shmem_dequeue_batch(struct rpmi_transport *trans,
+					 enum rpmi_queue_type qtype,
+					 struct rpmi_message *out_msgs,
+					 rpmi_uint32_t max_count)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+	rpmi_uint32_t count;
+
+	count = RPMI_MIN(max_count, shmem_pending_slots(trans, qtype));
+	if (!count) {
+		shqueue->stats.empty_count++;
+		return 0;
 	}
 
-	return 0;
+	if (shmem_copy_slots(trans, qtype, shqueue->head, count, out_msgs, false))
+		return 0;
+
+	if (shmem_advance_head(trans, qtype, count))
+		return 0;
+
+	return count;
+}
+
+static inline rpmi_bool_t shmem_is_a2p_queue(enum rpmi_queue_type qtype)
+{
+	return (qtype == RPMI_QUEUE_A2P_REQ || qtype == RPMI_QUEUE_A2P_ACK) ?
+		true : false;
+}
+
+static struct rpmi_message *shmem_peek_slot(struct rpmi_transport *trans,
+					    enum rpmi_queue_type qtype,
+					    rpmi_uint32_t index)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+	rpmi_uint32_t idx;
+
+	/*
+	 * Platform firmware consumes the A2P queues so peek at pending
+	 * messages from the head whereas it produces the P2A queues so
+	 * peek at free slots from the tail.
+	 */
+	if (shmem_is_a2p_queue(qtype)) {
+		if (index >= shmem_pending_slots(trans, qtype)) {
+			if (!index)
+				shqueue->stats.empty_count++;
+			return NULL;
+		}
+		idx = shmem_index_add(shqueue, shqueue->head, index);
+	} else {
+		if (index >= shmem_free_slots(trans, qtype, index + 1)) {
+			shqueue->stats.full_count++;
+			return NULL;
+		}
+		idx = shmem_index_add(shqueue, shqueue->tail, index);
+	}
+
+	idx = shmem_slot_pos(shqueue, idx);
+	return rpmi_shmem_direct_ptr(shtrans->shmem,
+				     shqueue->queue_base + ((idx + 2) * trans->slot_size),
+				     trans->slot_size);
+}
+
+static enum rpmi_error shmem_commit_slot(struct rpmi_transport *trans,
+					 enum rpmi_queue_type qtype,
+					 rpmi_uint32_t count)
+{
+	if (shmem_is_a2p_queue(qtype)) {
+		if (count > shmem_pending_slots(trans, qtype))
+			return RPMI_ERR_INVALID_PARAM;
+		return shmem_advance_head(trans, qtype, count);
+	}
+
+	if (count > shmem_free_slots(trans, qtype, count))
+		return RPMI_ERR_INVALID_PARAM;
+	return shmem_advance_tail(trans, qtype, count);
+}
+
+static void shmem_get_queue_stats(struct rpmi_transport *trans,
+				  enum rpmi_queue_type qtype,
+				  struct rpmi_transport_queue_stats *stats)
+{
+	struct rpmi_transport_shmem *shtrans = trans->priv;
+	struct rpmi_transport_shmem_queue *shqueue = &shtrans->queues[qtype];
+
+	*stats = shqueue->stats;
+	stats->capacity = shmem_capacity(shqueue);
 }
 
 struct rpmi_transport *rpmi_transport_shmem_create(const char *name,
 						   rpmi_uint32_t slot_size,
 						   rpmi_uint32_t a2p_req_queue_size,
 						   rpmi_uint32_t p2a_req_queue_size,
-						   struct rpmi_shmem *shmem)
+						   struct rpmi_shmem *shmem,
+						   rpmi_uint32_t flags)
 {
 	struct rpmi_transport_shmem_queue *shqueue;
 	struct rpmi_transport_shmem *shtrans;
@@ -246,6 +532,13 @@ struct rpmi_transport *rpmi_transport_shmem_create(const char *name,
 		else
 			shqueue->queue_base = 0;
 		shqueue->data_slots = rpmi_env_div32(shqueue->queue_size, slot_size) - 2;
+		if (flags & LIBRPMI_TRANSPORT_SHMEM_FLAG_POW2) {
+			/* Use the largest power-of-two number of data slots */
+			while (shqueue->data_slots & (shqueue->data_slots - 1))
+				shqueue->data_slots &= shqueue->data_slots - 1;
+			shqueue->is_pow2 = true;
+			shqueue->slot_mask = shqueue->data_slots - 1;
+		}
 	}
 
 	trans = &shtrans->trans;
@@ -253,11 +546,19 @@ struct rpmi_transport *rpmi_transport_shmem_create(const char *name,
 	trans->is_be = false;
 	trans->slot_size = slot_size;
 	trans->is_p2a_channel = p2a_req_queue_size ? true : false;
+	trans->is_spsc = (flags & LIBRPMI_TRANSPORT_SHMEM_FLAG_SPSC) ? true : false;
 	trans->is_empty = shmem_is_empty;
 	trans->is_full = shmem_is_full;
 	trans->enqueue = shmem_enqueue;
 	trans->dequeue = shmem_dequeue;
-	trans->lock = rpmi_env_alloc_lock();
+	trans->enqueue_batch = shmem_enqueue_batch;
+	trans->dequeue_batch = shmem_dequeue_batch;
+	trans->get_queue_stats = shmem_get_queue_stats;
+	if (rpmi_shmem_direct_ptr(shmem, 0, rpmi_shmem_size(shmem))) {
+		trans->peek_slot = shmem_peek_slot;
+		trans->commit_slot = shmem_commit_slot;
+	}
+	trans->lock = (trans->is_spsc) ? NULL : rpmi_env_alloc_lock();
 	trans->priv = shtrans;
 
 	return trans;
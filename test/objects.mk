@@ -14,7 +14,22 @@ test-elfs-y += test_srvgrp_sysreset
 test_srvgrp_sysreset-objs-y += test/test_log.o
 test_srvgrp_sysreset-objs-y += test/test_common.o
 
+test-elfs-y += test_srvgrp_syssusp
+
+test_srvgrp_syssusp-objs-y += test/test_log.o
+test_srvgrp_syssusp-objs-y += test/test_common.o
+
 test-elfs-y += test_srvgrp_hsm
 
 test_srvgrp_hsm-objs-y += test/test_log.o
 test_srvgrp_hsm-objs-y += test/test_common.o
+
+test-elfs-y += test_srvgrp_perf
+
+test_srvgrp_perf-objs-y += test/test_log.o
+test_srvgrp_perf-objs-y += test/test_common.o
+
+test-elfs-y += test_transport_shmem
+
+test_transport_shmem-objs-y += test/test_log.o
+test_transport_shmem-objs-y += test/test_common.o
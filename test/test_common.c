@@ -6,6 +6,21 @@
 
 #include "test_common.h"
 
+/* Number of tests reported as failed so far */
+static int test_failures;
+
+void test_report(const char *name, int failed)
+{
+	printf("TEST: %-50s \t : %s!\n", name, failed ? "Failed" : "Succeeded");
+	if (failed)
+		test_failures++;
+}
+
+int test_failure_count(void)
+{
+	return test_failures;
+}
+
 /* dump buffer in hexadecimal format */
 void hexdump(char *desc, unsigned int *buf, unsigned int len)
 {
@@ -106,7 +121,7 @@ static void test_verify(struct rpmi_test *test, struct rpmi_message *msg,
 		}
 	}
 
-	printf("TEST: %-50s \t : %s!\n", test->name, failed ? "Failed" : "Succeeded");
+	test_report(test->name, failed);
 }
 
 static void execute_scenario(struct rpmi_test_scenario *scene)
@@ -148,6 +163,7 @@ static void execute_scenario(struct rpmi_test_scenario *scene)
 			rc = 0;
 		if (rc) {
 			printf("Failed to initialize test %s (error %d)\n", test->name, rc);
+			test_failures++;
 			continue;
 		}
 
@@ -178,6 +194,7 @@ static void execute_scenario(struct rpmi_test_scenario *scene)
 			rc = test_run(scene, test, req_msg);
 		if (rc) {
 			printf("Failed to run test %s (error %d)\n", test->name, rc);
+			test_failures++;
 			goto skip;
 		}
 
@@ -244,7 +261,7 @@ int test_scenario_default_init(struct rpmi_test_scenario *scene)
 	scene->xport = rpmi_transport_shmem_create("test_transport", scene->slot_size,
 						   ((scene->shm_size * 3) / 4) / 2,
 						   ((scene->shm_size * 1) / 4) / 2,
-						   scene->shmem);
+						   scene->shmem, 0);
 	if (!scene->xport) {
 		printf("%s: failed to create test rpmi_transport\n ", __func__);
 		rpmi_shmem_destroy(scene->shmem);
@@ -300,7 +317,7 @@ int test_scenario_default_cleanup(struct rpmi_test_scenario *scene)
 
 int test_scenario_execute(struct rpmi_test_scenario *scene)
 {
-	int rc;
+	int rc, failures;
 
 	if (!scene || !scene->init || !scene->cleanup) {
 		printf("Invalid test scenario\n");
@@ -313,6 +330,7 @@ int test_scenario_execute(struct rpmi_test_scenario *scene)
 		return rc;
 	}
 
+	failures = test_failures;
 	execute_scenario(scene);
 
 	rc = scene->cleanup(scene);
@@ -321,5 +339,5 @@ int test_scenario_execute(struct rpmi_test_scenario *scene)
 		return rc;
 	}
 
-	return 0;
+	return (test_failures != failures) ? RPMI_ERR_FAILED : 0;
 }
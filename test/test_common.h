@@ -91,6 +91,10 @@ rpmi_uint16_t test_init_expected_data_from_attrs(struct rpmi_test_scenario *scen
 						 struct rpmi_test *test,
 						 void *data, rpmi_uint16_t max_data_len);
 
+/* Print the result of a test and count it if failed */
+void test_report(const char *name, int failed);
+int test_failure_count(void);
+
 int test_scenario_default_init(struct rpmi_test_scenario *scene);
 int test_scenario_default_cleanup(struct rpmi_test_scenario *scene);
 
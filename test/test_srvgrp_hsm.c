@@ -398,8 +398,416 @@ static struct rpmi_test_scenario scenario_hsm_default = {
 	},
 };
 
+/* Hart lookups through a non-leaf HSM with consecutive and sparse hart IDs */
+static void test_hsm_nonleaf_lookup(void)
+{
+	static const rpmi_uint32_t leaf0_ids[] = { 8, 9, 10, 11 };
+	static const rpmi_uint32_t leaf1_ids[] = { 3, 1, 7, 5 };
+	struct rpmi_hsm *leaf[2] = { NULL, NULL };
+	struct rpmi_hsm *nonleaf = NULL;
+	rpmi_uint32_t i, hart_id;
+	int failed = 1;
+
+	leaf[0] = rpmi_hsm_create(4, leaf0_ids, 0, NULL, &test_hsm_ops, NULL);
+	leaf[1] = rpmi_hsm_create(4, leaf1_ids, 0, NULL, &test_hsm_ops, NULL);
+	if (!leaf[0] || !leaf[1])
+		goto done;
+	nonleaf = rpmi_hsm_nonleaf_create(2, leaf);
+	if (!nonleaf || rpmi_hsm_hart_count(nonleaf) != 8)
+		goto done;
+
+	for (i = 0; i < 8; i++) {
+		hart_id = (i < 4) ? leaf0_ids[i] : leaf1_ids[i - 4];
+		if (rpmi_hsm_hart_index2id(nonleaf, i) != hart_id ||
+		    rpmi_hsm_hart_id2index(nonleaf, hart_id) != i ||
+		    rpmi_hsm_get_hart_state(nonleaf, hart_id) !=
+		    RPMI_HSM_HART_STATE_STARTED)
+			goto done;
+	}
+
+	if (rpmi_hsm_hart_id2index(nonleaf, 0) != LIBRPMI_HSM_INVALID_HART_INDEX ||
+	    rpmi_hsm_hart_id2index(nonleaf, 12) != LIBRPMI_HSM_INVALID_HART_INDEX ||
+	    rpmi_hsm_hart_id2index(leaf[0], 7) != LIBRPMI_HSM_INVALID_HART_INDEX ||
+	    rpmi_hsm_hart_index2id(nonleaf, 8) != LIBRPMI_HSM_INVALID_HART_ID)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("NON-LEAF HART LOOKUP", failed);
+
+	if (nonleaf)
+		rpmi_hsm_destroy(nonleaf);
+	for (i = 0; i < 2; i++) {
+		if (leaf[i])
+			rpmi_hsm_destroy(leaf[i]);
+	}
+}
+
+/* Platform callbacks for bulk hart operations on a separate set of harts */
+static rpmi_uint32_t test_bulk_hart_state[8];
+static rpmi_uint32_t test_bulk_prepare_calls;
+
+static enum rpmi_hart_hw_state test_bulk_get_hw_state(void *priv,
+						       rpmi_uint32_t hart_index)
+{
+	return test_bulk_hart_state[hart_index];
+}
+
+static enum rpmi_error test_bulk_start_prepare_mask(void *priv,
+						    rpmi_uint32_t hart_index_base,
+						    rpmi_uint64_t hart_index_mask,
+						    rpmi_uint64_t start_addr)
+{
+	rpmi_uint32_t i;
+
+	test_bulk_prepare_calls++;
+	for (i = 0; i < 64; i++) {
+		if (hart_index_mask & (1ULL << i))
+			test_bulk_hart_state[hart_index_base + i] =
+						RPMI_HART_HW_STATE_STARTED;
+	}
+
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error test_bulk_suspend_prepare_mask(void *priv,
+				rpmi_uint32_t hart_index_base,
+				rpmi_uint64_t hart_index_mask,
+				const struct rpmi_hsm_suspend_type *suspend_type,
+				rpmi_uint64_t resume_addr)
+{
+	rpmi_uint32_t i;
+
+	test_bulk_prepare_calls++;
+	for (i = 0; i < 64; i++) {
+		if (hart_index_mask & (1ULL << i))
+			test_bulk_hart_state[hart_index_base + i] =
+						RPMI_HART_HW_STATE_SUSPENDED;
+	}
+
+	return RPMI_SUCCESS;
+}
+
+static struct rpmi_hsm_platform_ops test_bulk_hsm_ops = {
+	.hart_get_hw_state = test_bulk_get_hw_state,
+	.hart_start_finalize = test_hart_start_finalize,
+	.hart_suspend_finalize = test_hart_suspend_finalize,
+	.hart_start_prepare_mask = test_bulk_start_prepare_mask,
+	.hart_suspend_prepare_mask = test_bulk_suspend_prepare_mask,
+};
+
+/* Start and suspend a set of harts with one platform call each */
+static void test_hsm_bulk(void)
+{
+	static const rpmi_uint32_t hart_ids[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	static const struct rpmi_hsm_suspend_type suspend_types[] = {
+		{ .type = 0 },
+	};
+	rpmi_uint32_t i, failed_mask;
+	struct rpmi_hsm *hsm;
+	int failed = 1;
+
+	/* Harts 0-5 are stopped and harts 6-7 are running */
+	for (i = 0; i < 8; i++)
+		test_bulk_hart_state[i] = (i < 6) ? RPMI_HART_HW_STATE_STOPPED :
+						    RPMI_HART_HW_STATE_STARTED;
+
+	hsm = rpmi_hsm_create(8, hart_ids, 1, suspend_types,
+			      &test_bulk_hsm_ops, NULL);
+	if (!hsm)
+		goto done;
+
+	/* Already started harts are skipped */
+	if (rpmi_hsm_hart_start_mask(hsm, 0, 0xff, 0x80000000, &failed_mask) ||
+	    failed_mask || test_bulk_prepare_calls != 1)
+		goto done;
+	for (i = 0; i < 8; i++) {
+		if (rpmi_hsm_get_hart_state(hsm, i) != RPMI_HSM_HART_STATE_STARTED)
+			goto done;
+	}
+
+	if (rpmi_hsm_hart_suspend_mask(hsm, 2, 0x3, &suspend_types[0], 0,
+				       &failed_mask) ||
+	    failed_mask || test_bulk_prepare_calls != 2 ||
+	    rpmi_hsm_get_hart_state(hsm, 2) != RPMI_HSM_HART_STATE_SUSPENDED ||
+	    rpmi_hsm_get_hart_state(hsm, 3) != RPMI_HSM_HART_STATE_SUSPENDED)
+		goto done;
+
+	/* Suspended harts can't be started and unknown harts are rejected */
+	if (rpmi_hsm_hart_start_mask(hsm, 2, 0x1, 0, &failed_mask) !=
+	    RPMI_ERR_DENIED || failed_mask != 0x1 ||
+	    rpmi_hsm_hart_start_mask(hsm, 7, 0x3, 0, &failed_mask) !=
+	    RPMI_ERR_INVALID_PARAM || failed_mask != 0x3 ||
+	    test_bulk_prepare_calls != 2)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("BULK HART START AND SUSPEND", failed);
+
+	if (hsm)
+		rpmi_hsm_destroy(hsm);
+}
+
+/* Platform callbacks whose HW state changes only when the test says so */
+static rpmi_uint32_t test_notify_hart_state[4];
+static rpmi_uint32_t test_notify_hw_reads;
+
+static enum rpmi_hart_hw_state test_notify_get_hw_state(void *priv,
+							rpmi_uint32_t hart_index)
+{
+	test_notify_hw_reads++;
+	return test_notify_hart_state[hart_index];
+}
+
+static enum rpmi_error test_notify_start_prepare(void *priv,
+						 rpmi_uint32_t hart_index,
+						 rpmi_uint64_t start_addr)
+{
+	return RPMI_SUCCESS;
+}
+
+static struct rpmi_hsm_platform_ops test_notify_hsm_ops = {
+	.hart_get_hw_state = test_notify_get_hw_state,
+	.hart_start_prepare = test_notify_start_prepare,
+	.hart_start_finalize = test_hart_start_finalize,
+};
+
+/* State change processing only reads HW state of harts in transition */
+static void test_hsm_pending_harts(void)
+{
+	static const rpmi_uint32_t hart_ids[] = { 0, 1, 2, 3 };
+	struct rpmi_hsm *hsm;
+	rpmi_uint32_t i;
+	int failed = 1;
+
+	for (i = 0; i < 4; i++)
+		test_notify_hart_state[i] = RPMI_HART_HW_STATE_STOPPED;
+	test_notify_hart_state[0] = RPMI_HART_HW_STATE_STARTED;
+
+	hsm = rpmi_hsm_create(4, hart_ids, 0, NULL, &test_notify_hsm_ops, NULL);
+	if (!hsm || test_notify_hw_reads != 4)
+		goto done;
+
+	/* Nothing in transition */
+	if (rpmi_hsm_process_state_changes(hsm) || test_notify_hw_reads != 4)
+		goto done;
+
+	/* Start pending hart is checked until the HW reports it started */
+	if (rpmi_hsm_hart_start(hsm, 2, 0) || test_notify_hw_reads != 5)
+		goto done;
+	if (!rpmi_hsm_process_state_changes(hsm) || test_notify_hw_reads != 6 ||
+	    rpmi_hsm_get_hart_state(hsm, 2) != RPMI_HSM_HART_STATE_START_PENDING)
+		goto done;
+	test_notify_hart_state[2] = RPMI_HART_HW_STATE_STARTED;
+	if (rpmi_hsm_process_state_changes(hsm))
+		goto done;
+	rpmi_hsm_process_state_changes(hsm);
+	if (test_notify_hw_reads != 7 ||
+	    rpmi_hsm_get_hart_state(hsm, 2) != RPMI_HSM_HART_STATE_STARTED)
+		goto done;
+
+	/* Notified hart is checked once */
+	if (rpmi_hsm_notify_hw_state(hsm, 3) ||
+	    rpmi_hsm_notify_hw_state(hsm, 4) != RPMI_ERR_INVALID_PARAM)
+		goto done;
+	rpmi_hsm_process_state_changes(hsm);
+	rpmi_hsm_process_state_changes(hsm);
+	if (test_notify_hw_reads != 8)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("PENDING HART STATE PROCESSING", failed);
+
+	if (hsm)
+		rpmi_hsm_destroy(hsm);
+}
+
+/* Suspended harts are polled unless the platform notifies their wakeup */
+static void test_hsm_wakeup_notify(void)
+{
+	static const rpmi_uint32_t hart_ids[] = { 0, 1 };
+	struct rpmi_hsm *hsm;
+	rpmi_uint32_t reads;
+	int failed = 1;
+
+	test_notify_hart_state[0] = RPMI_HART_HW_STATE_STARTED;
+	test_notify_hart_state[1] = RPMI_HART_HW_STATE_SUSPENDED;
+
+	hsm = rpmi_hsm_create(2, hart_ids, 0, NULL, &test_notify_hsm_ops, NULL);
+	if (!hsm ||
+	    rpmi_hsm_get_hart_state(hsm, 1) != RPMI_HSM_HART_STATE_SUSPENDED)
+		goto done;
+
+	/* Suspended hart is polled by default */
+	reads = test_notify_hw_reads;
+	rpmi_hsm_process_state_changes(hsm);
+	rpmi_hsm_process_state_changes(hsm);
+	if (test_notify_hw_reads != reads + 2)
+		goto done;
+
+	/* Checked once more and then only upon notification */
+	rpmi_hsm_set_wakeup_notify(hsm, true);
+	rpmi_hsm_process_state_changes(hsm);
+	rpmi_hsm_process_state_changes(hsm);
+	if (test_notify_hw_reads != reads + 3)
+		goto done;
+	test_notify_hart_state[1] = RPMI_HART_HW_STATE_STARTED;
+	rpmi_hsm_process_state_changes(hsm);
+	if (test_notify_hw_reads != reads + 3 ||
+	    rpmi_hsm_get_hart_state(hsm, 1) != RPMI_HSM_HART_STATE_SUSPENDED)
+		goto done;
+	if (rpmi_hsm_notify_hw_state(hsm, 1))
+		goto done;
+	rpmi_hsm_process_state_changes(hsm);
+	if (test_notify_hw_reads != reads + 4 ||
+	    rpmi_hsm_get_hart_state(hsm, 1) != RPMI_HSM_HART_STATE_STARTED)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("SUSPENDED HART WAKEUP NOTIFICATION", failed);
+
+	if (hsm)
+		rpmi_hsm_destroy(hsm);
+}
+
+/* HSM service group is marked pending by hart state changes without a sweep */
+static void test_hsm_group_pending(void)
+{
+	static const rpmi_uint32_t hart_ids[] = { 0, 1, 2, 3 };
+	struct rpmi_service_group *group = NULL;
+	struct rpmi_transport *xport = NULL;
+	struct rpmi_context *cntx = NULL;
+	struct rpmi_shmem *shmem = NULL;
+	struct rpmi_hsm *hsm = NULL;
+	void *shm = NULL;
+	rpmi_uint32_t i;
+	int failed = 1;
+
+	for (i = 0; i < 4; i++)
+		test_notify_hart_state[i] = RPMI_HART_HW_STATE_STOPPED;
+
+	shm = rpmi_env_zalloc(RPMI_SHM_SZ);
+	if (!shm)
+		goto done;
+	shmem = rpmi_shmem_create("test_shmem", (unsigned long)shm, RPMI_SHM_SZ,
+				  &rpmi_shmem_simple_ops, NULL);
+	if (!shmem)
+		goto done;
+	xport = rpmi_transport_shmem_create("test_transport", RPMI_SLOT_SIZE,
+					    RPMI_SHM_SZ / 4, RPMI_SHM_SZ / 4,
+					    shmem, 0);
+	if (!xport)
+		goto done;
+	cntx = rpmi_context_create("test_context", xport, 2,
+				   RPMI_PRIVILEGE_M_MODE, 0, NULL);
+	hsm = rpmi_hsm_create(4, hart_ids, 0, NULL, &test_notify_hsm_ops, NULL);
+	group = (hsm) ? rpmi_service_group_hsm_create(hsm) : NULL;
+	if (!cntx || !group || rpmi_context_add_group(cntx, group))
+		goto done;
+	rpmi_context_set_event_sweep_period(cntx, 0);
+
+	/* Hart start marks the group pending */
+	if (rpmi_hsm_hart_start(hsm, 1, 0) || rpmi_hsm_hart_start(hsm, 2, 0))
+		goto done;
+	test_notify_hart_state[1] = RPMI_HART_HW_STATE_STARTED;
+	rpmi_context_process_all_events(cntx);
+	if (rpmi_hsm_get_hart_state(hsm, 1) != RPMI_HSM_HART_STATE_STARTED ||
+	    rpmi_hsm_get_hart_state(hsm, 2) != RPMI_HSM_HART_STATE_START_PENDING)
+		goto done;
+
+	/* Hart still in transition keeps the group pending without a sweep */
+	test_notify_hart_state[2] = RPMI_HART_HW_STATE_STARTED;
+	rpmi_context_process_all_events(cntx);
+	if (rpmi_hsm_get_hart_state(hsm, 2) != RPMI_HSM_HART_STATE_STARTED)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("HSM GROUP MARKED PENDING", failed);
+
+	if (cntx) {
+		if (group)
+			rpmi_context_remove_group(cntx, group);
+		rpmi_context_destroy(cntx);
+	}
+	if (group)
+		rpmi_service_group_hsm_destroy(group);
+	if (hsm)
+		rpmi_hsm_destroy(hsm);
+	if (xport)
+		rpmi_transport_shmem_destroy(xport);
+	if (shmem)
+		rpmi_shmem_destroy(shmem);
+	rpmi_env_free(shm);
+}
+
+/* Suspend type lookup with unsorted and repeated type values */
+static void test_hsm_suspend_type_lookup(void)
+{
+	static const struct rpmi_hsm_suspend_type types[] = {
+		{ .type = 0x80000001 },
+		{ .type = 0x00000000 },
+		{ .type = 0x80000000 },
+		{ .type = 0x00000000 },
+		{ .type = 0x00000010 },
+	};
+	static const rpmi_uint32_t leaf0_ids[] = { 0, 1 };
+	static const rpmi_uint32_t leaf1_ids[] = { 2, 3 };
+	struct rpmi_hsm *leaf[2] = { NULL, NULL };
+	struct rpmi_hsm *nonleaf = NULL;
+	rpmi_uint32_t i;
+	int failed = 1;
+
+	leaf[0] = rpmi_hsm_create(2, leaf0_ids, 5, types, &test_hsm_ops, NULL);
+	leaf[1] = rpmi_hsm_create(2, leaf1_ids, 5, types, &test_hsm_ops, NULL);
+	if (!leaf[0] || !leaf[1])
+		goto done;
+	nonleaf = rpmi_hsm_nonleaf_create(2, leaf);
+	if (!nonleaf || rpmi_hsm_get_suspend_type_count(nonleaf) != 5)
+		goto done;
+
+	for (i = 0; i < 5; i++) {
+		if (rpmi_hsm_get_suspend_type(nonleaf, i) != &types[i])
+			goto done;
+	}
+
+	/* First of the repeated type values is found */
+	if (rpmi_hsm_find_suspend_type(leaf[0], 0x0) != &types[1] ||
+	    rpmi_hsm_find_suspend_type(nonleaf, 0x0) != &types[1] ||
+	    rpmi_hsm_find_suspend_type(nonleaf, 0x10) != &types[4] ||
+	    rpmi_hsm_find_suspend_type(nonleaf, 0x80000000) != &types[2] ||
+	    rpmi_hsm_find_suspend_type(nonleaf, 0x80000001) != &types[0] ||
+	    rpmi_hsm_find_suspend_type(nonleaf, 0x1) ||
+	    rpmi_hsm_find_suspend_type(nonleaf, 0xffffffff))
+		goto done;
+
+	failed = 0;
+done:
+	test_report("SUSPEND TYPE LOOKUP", failed);
+
+	if (nonleaf)
+		rpmi_hsm_destroy(nonleaf);
+	for (i = 0; i < 2; i++) {
+		if (leaf[i])
+			rpmi_hsm_destroy(leaf[i]);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	printf("Test Hart State Management Service Group\n");
-	return test_scenario_execute(&scenario_hsm_default);;
+	test_hsm_nonleaf_lookup();
+	test_hsm_bulk();
+	test_hsm_pending_harts();
+	test_hsm_wakeup_notify();
+	test_hsm_group_pending();
+	test_hsm_suspend_type_lookup();
+
+	if (test_scenario_execute(&scenario_hsm_default))
+		return 1;
+
+	return test_failure_count() ? 1 : 0;
 }
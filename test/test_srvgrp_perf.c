@@ -0,0 +1,242 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2024 Ventana Micro Systems Inc.
+ */
+
+#include <librpmi.h>
+#include <stdio.h>
+#include "test_common.h"
+#include "test_log.h"
+
+#define TEST_PERF_DOMAIN_COUNT		2
+
+static rpmi_uint32_t test_perf_level[TEST_PERF_DOMAIN_COUNT];
+
+static struct rpmi_perf_level test_perf_levels[] = {
+	{ .level_index = 0, .clock_freq = 1000, .power_cost = 10,
+	  .transition_latency = 5 },
+	{ .level_index = 1, .clock_freq = 2000, .power_cost = 20,
+	  .transition_latency = 5 },
+};
+
+static const struct rpmi_perf_data test_perf_data[TEST_PERF_DOMAIN_COUNT] = {
+	{
+		.name = "cpu0",
+		.perf_level_count = 2,
+		.perf_level_array = test_perf_levels,
+	},
+	{
+		.name = "cpu1",
+		.perf_level_count = 2,
+		.perf_level_array = test_perf_levels,
+	},
+};
+
+static const struct rpmi_perf_fc_memory_region test_perf_fc_region;
+
+static enum rpmi_error test_perf_get_level(void *priv, rpmi_uint32_t perf_id,
+					   rpmi_uint32_t *perf_level)
+{
+	*perf_level = test_perf_level[perf_id];
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error test_perf_set_level(void *priv, rpmi_uint32_t perf_id,
+					   rpmi_uint32_t perf_level)
+{
+	test_perf_level[perf_id] = perf_level;
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error test_perf_get_limit(void *priv, rpmi_uint32_t perf_id,
+					   rpmi_uint32_t *max_perf_limit,
+					   rpmi_uint32_t *min_perf_limit)
+{
+	*max_perf_limit = 1;
+	*min_perf_limit = 0;
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error test_perf_set_limit(void *priv, rpmi_uint32_t perf_id,
+					   rpmi_uint32_t max_perf_limit,
+					   rpmi_uint32_t min_perf_limit)
+{
+	return RPMI_SUCCESS;
+}
+
+static const struct rpmi_perf_platform_ops test_perf_ops = {
+	.get_level = test_perf_get_level,
+	.set_level = test_perf_set_level,
+	.get_limit = test_perf_get_limit,
+	.set_limit = test_perf_set_limit,
+};
+
+static int test_perf_request(struct rpmi_transport *xport,
+			     struct rpmi_message *msg, rpmi_uint8_t service_id,
+			     const rpmi_uint32_t *data, rpmi_uint32_t num_words)
+{
+	rpmi_uint32_t i;
+
+	rpmi_env_memset(msg, 0, RPMI_SLOT_SIZE);
+	msg->header.servicegroup_id = RPMI_SRVGRP_PERFORMANCE;
+	msg->header.service_id = service_id;
+	msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+	msg->header.datalen = num_words * sizeof(rpmi_uint32_t);
+	for (i = 0; i < num_words; i++)
+		((rpmi_uint32_t *)msg->data)[i] = data[i];
+
+	return rpmi_transport_enqueue(xport, RPMI_QUEUE_A2P_REQ, msg) ? -1 : 0;
+}
+
+/* Check the next notification message carries exactly one event */
+static int test_perf_check_event(struct rpmi_transport *xport,
+				 struct rpmi_message *msg, rpmi_uint8_t event_id,
+				 const rpmi_uint32_t *data, rpmi_uint32_t num_words)
+{
+	rpmi_uint32_t i, *words = (void *)msg->data;
+
+	if (rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_REQ, msg) ||
+	    msg->header.flags != RPMI_MSG_NOTIFICATION ||
+	    msg->header.servicegroup_id != RPMI_SRVGRP_PERFORMANCE ||
+	    msg->header.datalen != (num_words + 1) * sizeof(rpmi_uint32_t) ||
+	    words[0] != RPMI_NOTIF_EVENT_HDR(event_id,
+					     num_words * sizeof(rpmi_uint32_t)))
+		return -1;
+
+	for (i = 0; i < num_words; i++) {
+		if (words[i + 1] != data[i])
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Level and limit changes are sent as notifications once enabled */
+static void test_perf_notifications(void)
+{
+	const rpmi_uint32_t enable_level[2] = { RPMI_PERF_LEVEL_CHANGE,
+						RPMI_NOTIF_STATE_ENABLE };
+	const rpmi_uint32_t enable_limit[2] = { RPMI_PERF_LIMIT_CHANGE,
+						RPMI_NOTIF_STATE_ENABLE };
+	const rpmi_uint32_t set_level[2] = { 1, 1 };
+	const rpmi_uint32_t set_limit[3] = { 0, 1, 0 };
+	const rpmi_uint32_t plat_level[2] = { 0, 0 };
+	struct rpmi_service_group *group = NULL;
+	struct rpmi_transport *xport = NULL;
+	struct rpmi_context *cntx = NULL;
+	struct rpmi_shmem *shmem = NULL;
+	struct rpmi_message *msg = NULL;
+	rpmi_uint32_t *data;
+	void *shm = NULL;
+	int failed = 1;
+
+	shm = rpmi_env_zalloc(RPMI_SHM_SZ);
+	msg = rpmi_env_zalloc(RPMI_SLOT_SIZE);
+	if (!shm || !msg)
+		goto done;
+	data = (void *)msg->data;
+	shmem = rpmi_shmem_create("test_shmem", (unsigned long)shm, RPMI_SHM_SZ,
+				  &rpmi_shmem_simple_ops, NULL);
+	if (!shmem)
+		goto done;
+	xport = rpmi_transport_shmem_create("test_transport", RPMI_SLOT_SIZE,
+					    RPMI_SHM_SZ / 4, RPMI_SHM_SZ / 4,
+					    shmem, 0);
+	if (!xport)
+		goto done;
+	cntx = rpmi_context_create("test_context", xport, 2,
+				   RPMI_PRIVILEGE_M_MODE, 0, NULL);
+	group = rpmi_service_group_perf_create(TEST_PERF_DOMAIN_COUNT,
+					       test_perf_data, &test_perf_ops,
+					       &test_perf_fc_region, NULL);
+	if (!cntx || !group || rpmi_context_add_group(cntx, group))
+		goto done;
+
+	/* Changes are dropped until the events are enabled */
+	if (test_perf_request(xport, msg, RPMI_PERF_SRV_SET_PERF_LEVEL,
+			      set_level, 2))
+		goto done;
+	rpmi_context_process_a2p_request(cntx);
+	rpmi_context_process_all_events(cntx);
+	if (rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != RPMI_SUCCESS ||
+	    !rpmi_transport_is_empty(xport, RPMI_QUEUE_P2A_REQ))
+		goto done;
+
+	if (test_perf_request(xport, msg, RPMI_PERF_SRV_ENABLE_NOTIFICATION,
+			      enable_level, 2) ||
+	    test_perf_request(xport, msg, RPMI_PERF_SRV_ENABLE_NOTIFICATION,
+			      enable_limit, 2))
+		goto done;
+	rpmi_context_process_a2p_request(cntx);
+	if (rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != RPMI_SUCCESS ||
+	    rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != RPMI_SUCCESS)
+		goto done;
+
+	/* Level change requested by the application processor */
+	if (test_perf_request(xport, msg, RPMI_PERF_SRV_SET_PERF_LEVEL,
+			      set_level, 2))
+		goto done;
+	rpmi_context_process_a2p_request(cntx);
+	rpmi_context_process_all_events(cntx);
+	if (rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != RPMI_SUCCESS ||
+	    test_perf_check_event(xport, msg, RPMI_PERF_LEVEL_CHANGE,
+				  set_level, 2))
+		goto done;
+
+	/* Limit change requested by the application processor */
+	if (test_perf_request(xport, msg, RPMI_PERF_SRV_SET_PERF_LIMIT,
+			      set_limit, 3))
+		goto done;
+	rpmi_context_process_a2p_request(cntx);
+	rpmi_context_process_all_events(cntx);
+	if (rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != RPMI_SUCCESS ||
+	    test_perf_check_event(xport, msg, RPMI_PERF_LIMIT_CHANGE,
+				  set_limit, 3))
+		goto done;
+
+	/* Level change made by the platform, power change not enabled */
+	if (rpmi_service_group_perf_notify_level(group, 0, 0) ||
+	    rpmi_service_group_perf_notify_power(group, 0, 100) ||
+	    rpmi_service_group_perf_notify_level(group,
+						 TEST_PERF_DOMAIN_COUNT, 0) !=
+						 RPMI_ERR_INVALID_PARAM)
+		goto done;
+	rpmi_context_process_all_events(cntx);
+	if (test_perf_check_event(xport, msg, RPMI_PERF_LEVEL_CHANGE,
+				  plat_level, 2) ||
+	    !rpmi_transport_is_empty(xport, RPMI_QUEUE_P2A_REQ))
+		goto done;
+
+	failed = 0;
+done:
+	test_report("PERF NOTIFICATION EVENTS", failed);
+
+	if (cntx) {
+		if (group)
+			rpmi_context_remove_group(cntx, group);
+		rpmi_context_destroy(cntx);
+	}
+	if (group)
+		rpmi_service_group_perf_destroy(group);
+	if (xport)
+		rpmi_transport_shmem_destroy(xport);
+	if (shmem)
+		rpmi_shmem_destroy(shmem);
+	rpmi_env_free(msg);
+	rpmi_env_free(shm);
+}
+
+int main(int argc, char *argv[])
+{
+	printf("Test Performance Service Group\n");
+
+	test_perf_notifications();
+
+	return test_failure_count() ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2024 Ventana Micro Systems Inc.
+ */
+
+#include <librpmi.h>
+#include <stdio.h>
+#include "test_common.h"
+#include "test_log.h"
+
+#define TEST_SYSSUSP_HART_COUNT		2
+
+static const rpmi_uint32_t test_hart_ids[TEST_SYSSUSP_HART_COUNT] = { 0, 1 };
+
+static const struct rpmi_system_suspend_type test_syssusp_types[] = {
+	{ .type = 0, .attr = RPMI_SYSSUSP_ATTRS_FLAGS_RESUMEADDR },
+};
+
+/* Platform state controlled by the test */
+static rpmi_bool_t test_suspend_ready;
+static rpmi_bool_t test_can_resume;
+static rpmi_uint32_t test_finalize_count;
+static rpmi_uint32_t test_resume_count;
+
+static enum rpmi_hart_hw_state test_get_hw_state(void *priv,
+						 rpmi_uint32_t hart_index)
+{
+	return (hart_index) ? RPMI_HART_HW_STATE_STOPPED :
+			      RPMI_HART_HW_STATE_STARTED;
+}
+
+static const struct rpmi_hsm_platform_ops test_hsm_ops = {
+	.hart_get_hw_state = test_get_hw_state,
+};
+
+static enum rpmi_error test_suspend_prepare(void *priv, rpmi_uint32_t hart_index,
+			const struct rpmi_system_suspend_type *syssusp_type,
+			rpmi_uint64_t resume_addr)
+{
+	return RPMI_SUCCESS;
+}
+
+static rpmi_bool_t test_suspend_ready_check(void *priv, rpmi_uint32_t hart_index)
+{
+	return test_suspend_ready;
+}
+
+static void test_suspend_finalize(void *priv, rpmi_uint32_t hart_index,
+			const struct rpmi_system_suspend_type *syssusp_type,
+			rpmi_uint64_t resume_addr)
+{
+	test_finalize_count++;
+}
+
+static rpmi_bool_t test_suspend_can_resume(void *priv, rpmi_uint32_t hart_index)
+{
+	return test_can_resume;
+}
+
+static enum rpmi_error test_suspend_resume(void *priv, rpmi_uint32_t hart_index,
+			const struct rpmi_system_suspend_type *syssusp_type,
+			rpmi_uint64_t resume_addr)
+{
+	test_resume_count++;
+	return RPMI_SUCCESS;
+}
+
+static const struct rpmi_syssusp_platform_ops test_syssusp_ops = {
+	.system_suspend_prepare = test_suspend_prepare,
+	.system_suspend_ready = test_suspend_ready_check,
+	.system_suspend_finalize = test_suspend_finalize,
+	.system_suspend_can_resume = test_suspend_can_resume,
+	.system_suspend_resume = test_suspend_resume,
+};
+
+/* System suspend completes and resumes without the event sweep */
+static void test_syssusp_group_pending(void)
+{
+	struct rpmi_service_group *group = NULL;
+	struct rpmi_transport *xport = NULL;
+	struct rpmi_context *cntx = NULL;
+	struct rpmi_shmem *shmem = NULL;
+	struct rpmi_message *msg = NULL;
+	struct rpmi_hsm *hsm = NULL;
+	rpmi_uint32_t *data;
+	void *shm = NULL;
+	int failed = 1;
+
+	shm = rpmi_env_zalloc(RPMI_SHM_SZ);
+	msg = rpmi_env_zalloc(RPMI_SLOT_SIZE);
+	if (!shm || !msg)
+		goto done;
+	data = (void *)msg->data;
+	shmem = rpmi_shmem_create("test_shmem", (unsigned long)shm, RPMI_SHM_SZ,
+				  &rpmi_shmem_simple_ops, NULL);
+	if (!shmem)
+		goto done;
+	xport = rpmi_transport_shmem_create("test_transport", RPMI_SLOT_SIZE,
+					    RPMI_SHM_SZ / 4, RPMI_SHM_SZ / 4,
+					    shmem, 0);
+	if (!xport)
+		goto done;
+	cntx = rpmi_context_create("test_context", xport, 2,
+				   RPMI_PRIVILEGE_M_MODE, 0, NULL);
+	hsm = rpmi_hsm_create(TEST_SYSSUSP_HART_COUNT, test_hart_ids, 0, NULL,
+			      &test_hsm_ops, NULL);
+	group = (hsm) ? rpmi_service_group_syssusp_create(hsm, 1,
+							  test_syssusp_types,
+							  &test_syssusp_ops,
+							  NULL) : NULL;
+	if (!cntx || !group || rpmi_context_add_group(cntx, group))
+		goto done;
+	rpmi_context_set_event_sweep_period(cntx, 0);
+
+	/* Hart 0 requests system suspend with hart 1 stopped */
+	rpmi_env_memset(msg, 0, RPMI_SLOT_SIZE);
+	msg->header.servicegroup_id = RPMI_SRVGRP_SYSTEM_SUSPEND;
+	msg->header.service_id = RPMI_SYSSUSP_SRV_SYSTEM_SUSPEND;
+	msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+	msg->header.datalen = 4 * sizeof(rpmi_uint32_t);
+	if (rpmi_transport_enqueue(xport, RPMI_QUEUE_A2P_REQ, msg))
+		goto done;
+	rpmi_context_process_a2p_request(cntx);
+	if (rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != RPMI_SUCCESS)
+		goto done;
+
+	/* Suspend is finalized once the platform is ready */
+	rpmi_context_process_all_events(cntx);
+	if (test_finalize_count)
+		goto done;
+	test_suspend_ready = true;
+	rpmi_context_process_all_events(cntx);
+	if (test_finalize_count != 1)
+		goto done;
+
+	/* Resume is polled while the system is suspended */
+	rpmi_context_process_all_events(cntx);
+	if (test_resume_count)
+		goto done;
+	test_can_resume = true;
+	rpmi_context_process_all_events(cntx);
+	rpmi_context_process_all_events(cntx);
+	if (test_finalize_count != 1 || test_resume_count != 1)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("SYSTEM SUSPEND GROUP MARKED PENDING", failed);
+
+	if (cntx) {
+		if (group)
+			rpmi_context_remove_group(cntx, group);
+		rpmi_context_destroy(cntx);
+	}
+	if (group)
+		rpmi_service_group_syssusp_destroy(group);
+	if (hsm)
+		rpmi_hsm_destroy(hsm);
+	if (xport)
+		rpmi_transport_shmem_destroy(xport);
+	if (shmem)
+		rpmi_shmem_destroy(shmem);
+	rpmi_env_free(msg);
+	rpmi_env_free(shm);
+}
+
+int main(int argc, char *argv[])
+{
+	printf("Test System Suspend Service Group\n");
+
+	test_syssusp_group_pending();
+
+	return test_failure_count() ? 1 : 0;
+}
@@ -0,0 +1,1711 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2024 Ventana Micro Systems Inc.
+ */
+
+#include <librpmi.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "test_common.h"
+#include "test_log.h"
+#include "librpmi_internal.h"
+
+#define TEST_BENCH_SHM_SIZE		(16 * 1024)
+#define TEST_BENCH_SLOT_SIZE		256
+#define TEST_BENCH_ITERATIONS		1024
+#define TEST_BENCH_BURST		4
+#define TEST_COPY_BENCH_BYTES		(64 * 1024 * 1024)
+
+#define TEST_ARRAY_SIZE(x)		(sizeof(x) / sizeof((x)[0]))
+
+/* Shared memory access counters of the platform firmware side */
+struct test_shmem_counters {
+	rpmi_bool_t enabled;
+	rpmi_uint64_t reads;
+	rpmi_uint64_t writes;
+	rpmi_uint64_t read_bytes;
+	rpmi_uint64_t write_bytes;
+};
+
+static enum rpmi_error test_shmem_count_read(void *priv, rpmi_uint64_t addr,
+					     void *in, rpmi_uint32_t len)
+{
+	struct test_shmem_counters *cnt = priv;
+
+	if (cnt->enabled) {
+		cnt->reads++;
+		cnt->read_bytes += len;
+	}
+	rpmi_env_memcpy(in, (const void *)(unsigned long)addr, len);
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error test_shmem_count_write(void *priv, rpmi_uint64_t addr,
+					      const void *out, rpmi_uint32_t len)
+{
+	struct test_shmem_counters *cnt = priv;
+
+	if (cnt->enabled) {
+		cnt->writes++;
+		cnt->write_bytes += len;
+	}
+	rpmi_env_memcpy((void *)(unsigned long)addr, out, len);
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error test_shmem_count_fill(void *priv, rpmi_uint64_t addr,
+					     char ch, rpmi_uint32_t len)
+{
+	rpmi_env_memset((void *)(unsigned long)addr, ch, len);
+	return RPMI_SUCCESS;
+}
+
+static struct rpmi_shmem_platform_ops test_shmem_count_ops = {
+	.read = test_shmem_count_read,
+	.write = test_shmem_count_write,
+	.fill = test_shmem_count_fill,
+};
+
+/* Shared memory, transport and (optional) context used by a test */
+struct test_fixture {
+	void *shm;
+	struct rpmi_shmem *shmem;
+	struct rpmi_transport *xport;
+	struct rpmi_context *cntx;
+	struct rpmi_message *msg;
+};
+
+static void test_fixture_teardown(struct test_fixture *fix)
+{
+	if (fix->cntx)
+		rpmi_context_destroy(fix->cntx);
+	if (fix->xport)
+		rpmi_transport_shmem_destroy(fix->xport);
+	if (fix->shmem)
+		rpmi_shmem_destroy(fix->shmem);
+	rpmi_env_free(fix->msg);
+	rpmi_env_free(fix->shm);
+	rpmi_env_memset(fix, 0, sizeof(*fix));
+}
+
+/*
+ * Create the shared memory and transport of a test with the given slot size.
+ * The context is created only for non-zero max_num_groups.
+ */
+static int test_fixture_setup_slots(struct test_fixture *fix,
+				    rpmi_uint32_t slot_size,
+				    const struct rpmi_shmem_platform_ops *ops,
+				    void *ops_priv, rpmi_uint32_t flags,
+				    rpmi_uint32_t max_num_groups)
+{
+	rpmi_env_memset(fix, 0, sizeof(*fix));
+
+	fix->shm = rpmi_env_zalloc(TEST_BENCH_SHM_SIZE);
+	fix->msg = rpmi_env_zalloc(slot_size);
+	if (!fix->shm || !fix->msg)
+		goto fail;
+
+	fix->shmem = rpmi_shmem_create("test_shmem", (unsigned long)fix->shm,
+				       TEST_BENCH_SHM_SIZE, ops, ops_priv);
+	if (!fix->shmem)
+		goto fail;
+
+	fix->xport = rpmi_transport_shmem_create("test_transport", slot_size,
+						 TEST_BENCH_SHM_SIZE / 4,
+						 TEST_BENCH_SHM_SIZE / 4,
+						 fix->shmem, flags);
+	if (!fix->xport)
+		goto fail;
+
+	if (max_num_groups) {
+		fix->cntx = rpmi_context_create("test_context", fix->xport,
+						max_num_groups,
+						RPMI_PRIVILEGE_M_MODE, 0, NULL);
+		if (!fix->cntx)
+			goto fail;
+	}
+
+	return 0;
+
+fail:
+	printf("%s: failed to create test fixture\n", __func__);
+	test_fixture_teardown(fix);
+	return -1;
+}
+
+static inline int test_fixture_setup(struct test_fixture *fix,
+				     const struct rpmi_shmem_platform_ops *ops,
+				     void *ops_priv, rpmi_uint32_t flags,
+				     rpmi_uint32_t max_num_groups)
+{
+	return test_fixture_setup_slots(fix, TEST_BENCH_SLOT_SIZE, ops, ops_priv,
+					flags, max_num_groups);
+}
+
+static int test_bench_run(struct rpmi_transport *xport, struct rpmi_context *cntx,
+			  struct test_shmem_counters *cnt, struct rpmi_message *msg)
+{
+	rpmi_uint32_t i, j, status;
+	int failed = 0;
+
+	for (i = 0; i < TEST_BENCH_ITERATIONS; i += TEST_BENCH_BURST) {
+		/* Application processor side: post a burst of requests */
+		for (j = 0; j < TEST_BENCH_BURST; j++) {
+			rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+			msg->header.servicegroup_id = RPMI_SRVGRP_BASE;
+			msg->header.service_id = RPMI_BASE_SRV_GET_IMPLEMENTATION_VERSION;
+			msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+			msg->header.token = i + j;
+			if (rpmi_transport_enqueue(xport, RPMI_QUEUE_A2P_REQ, msg))
+				return -1;
+		}
+
+		/* Platform firmware side: only this part is counted */
+		cnt->enabled = true;
+		rpmi_context_process_a2p_request(cntx);
+		cnt->enabled = false;
+
+		/* Application processor side: collect acknowledgements */
+		for (j = 0; j < TEST_BENCH_BURST; j++) {
+			if (rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg))
+				return -1;
+			status = ((rpmi_uint32_t *)msg->data)[0];
+			if (msg->header.token != (i + j) || status != RPMI_SUCCESS)
+				failed = 1;
+		}
+	}
+
+	return failed;
+}
+
+static void test_bench_layout(const char *name, rpmi_uint32_t flags)
+{
+	struct test_shmem_counters cnt = { 0 };
+	struct test_fixture fix = { 0 };
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &test_shmem_count_ops, &cnt, flags, 2))
+		goto done;
+
+	failed = test_bench_run(fix.xport, fix.cntx, &cnt, fix.msg);
+
+	printf("%s: messages: %d, slot size: %d, burst: %d\n", name,
+	       TEST_BENCH_ITERATIONS, TEST_BENCH_SLOT_SIZE, TEST_BENCH_BURST);
+	printf("%s: shmem reads per message: %.2f (%.1f bytes)\n", name,
+	       (double)cnt.reads / TEST_BENCH_ITERATIONS,
+	       (double)cnt.read_bytes / TEST_BENCH_ITERATIONS);
+	printf("%s: shmem writes per message: %.2f (%.1f bytes)\n", name,
+	       (double)cnt.writes / TEST_BENCH_ITERATIONS,
+	       (double)cnt.write_bytes / TEST_BENCH_ITERATIONS);
+
+done:
+	test_report(name, failed);
+	test_fixture_teardown(&fix);
+}
+
+static double test_time_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/* Throughput of copying messages through queue slots of the given size */
+static void test_bench_slot_copy(rpmi_uint32_t slot_size)
+{
+	rpmi_uint32_t i, count, batch;
+	struct rpmi_message *msgs;
+	struct test_fixture fix = { 0 };
+	double start, elapsed;
+	char name[64];
+	int failed = 1;
+
+	snprintf(name, sizeof(name), "Slot copy throughput (%d bytes)", slot_size);
+
+	msgs = rpmi_env_zalloc(TEST_BENCH_SHM_SIZE / 4);
+	if (!msgs ||
+	    test_fixture_setup_slots(&fix, slot_size, &rpmi_shmem_simple_ops, NULL,
+				     LIBRPMI_TRANSPORT_SHMEM_FLAG_SPSC, 0))
+		goto done;
+
+	/* Half of the queue slots are moved per batch so that it wraps around */
+	batch = ((TEST_BENCH_SHM_SIZE / 4) / slot_size - 2) / 2;
+	count = TEST_COPY_BENCH_BYTES / slot_size;
+
+	start = test_time_sec();
+	for (i = 0; i < count; i += batch) {
+		if (rpmi_transport_enqueue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+						 msgs, batch) != batch ||
+		    rpmi_transport_dequeue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+						 msgs, batch) != batch)
+			goto done;
+	}
+	elapsed = test_time_sec() - start;
+
+	/* Each message is copied into and out of a slot */
+	printf("%s: %.1f MB/s\n", name,
+	       (2.0 * i * slot_size) / (elapsed * 1024 * 1024));
+
+	failed = 0;
+done:
+	test_report(name, failed);
+	test_fixture_teardown(&fix);
+	rpmi_env_free(msgs);
+}
+
+static int test_post_requests(struct rpmi_transport *xport,
+			      struct rpmi_message *msg, rpmi_uint32_t count)
+{
+	rpmi_uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+		msg->header.servicegroup_id = RPMI_SRVGRP_BASE;
+		msg->header.service_id = RPMI_BASE_SRV_GET_IMPLEMENTATION_VERSION;
+		msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+		msg->header.token = i;
+		if (rpmi_transport_enqueue(xport, RPMI_QUEUE_A2P_REQ, msg))
+			return -1;
+	}
+
+	return 0;
+}
+
+static rpmi_uint32_t test_count_acks(struct rpmi_transport *xport,
+				     struct rpmi_message *msg)
+{
+	rpmi_uint32_t count = 0;
+
+	while (!rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg)) {
+		if (((rpmi_uint32_t *)msg->data)[0] == RPMI_SUCCESS)
+			count++;
+	}
+
+	return count;
+}
+
+/* Byte order of the 16-bit header fields of messages in shared memory */
+static void test_header_endianness(const char *name, rpmi_bool_t is_be)
+{
+	const struct rpmi_message_header hdr = {
+		.servicegroup_id = 0x1234,
+		.service_id = 0x56,
+		.flags = RPMI_MSG_NORMAL_REQUEST,
+		.datalen = 0x0008,
+		.token = 0xabcd,
+	};
+	struct test_fixture fix = { 0 };
+	const rpmi_uint8_t *raw;
+	rpmi_uint32_t i;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0, 0))
+		goto done;
+	fix.xport->is_be = is_be;
+
+	/* First slot is written by the single message path, second by batch */
+	fix.msg->header = hdr;
+	if (rpmi_transport_enqueue(fix.xport, RPMI_QUEUE_A2P_REQ, fix.msg) ||
+	    rpmi_transport_enqueue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+					 fix.msg, 1) != 1)
+		goto done;
+
+	/* Message of the caller is left in native endianness */
+	if (rpmi_env_memcmp(&fix.msg->header, (void *)&hdr, sizeof(hdr)))
+		goto done;
+
+	for (i = 0; i < 2; i++) {
+		raw = (const rpmi_uint8_t *)fix.shm + (i + 2) * TEST_BENCH_SLOT_SIZE;
+		if (raw[0] != (is_be ? 0x12 : 0x34) || raw[1] != (is_be ? 0x34 : 0x12) ||
+		    raw[2] != hdr.service_id || raw[3] != hdr.flags ||
+		    raw[4] != (is_be ? 0x00 : 0x08) || raw[5] != (is_be ? 0x08 : 0x00) ||
+		    raw[6] != (is_be ? 0xab : 0xcd) || raw[7] != (is_be ? 0xcd : 0xab))
+			goto done;
+	}
+
+	/* Both dequeue paths convert the header back to native endianness */
+	rpmi_env_memset(fix.msg, 0, TEST_BENCH_SLOT_SIZE);
+	if (rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_A2P_REQ, fix.msg) ||
+	    rpmi_env_memcmp(&fix.msg->header, (void *)&hdr, sizeof(hdr)))
+		goto done;
+	rpmi_env_memset(fix.msg, 0, TEST_BENCH_SLOT_SIZE);
+	if (rpmi_transport_dequeue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+					 fix.msg, 1) != 1 ||
+	    rpmi_env_memcmp(&fix.msg->header, (void *)&hdr, sizeof(hdr)))
+		goto done;
+
+	failed = 0;
+done:
+	test_report(name, failed);
+	test_fixture_teardown(&fix);
+}
+
+static void test_batch_fill(struct rpmi_transport *xport, struct rpmi_message *msgs,
+			    rpmi_uint32_t count, rpmi_uint32_t base)
+{
+	struct rpmi_message *msg;
+	rpmi_uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		msg = rpmi_transport_batch_msg(xport, msgs, i);
+		rpmi_env_memset(msg, 0, xport->slot_size);
+		msg->header.servicegroup_id = RPMI_SRVGRP_BASE;
+		msg->header.flags = RPMI_MSG_POSTED_REQUEST;
+		msg->header.datalen = sizeof(rpmi_uint32_t);
+		msg->header.token = base + i;
+		((rpmi_uint32_t *)msg->data)[0] = ~(base + i);
+	}
+}
+
+static int test_batch_check(struct rpmi_transport *xport, struct rpmi_message *msgs,
+			    rpmi_uint32_t count, rpmi_uint32_t base)
+{
+	struct rpmi_message *msg;
+	rpmi_uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		msg = rpmi_transport_batch_msg(xport, msgs, i);
+		if (msg->header.token != (rpmi_uint16_t)(base + i) ||
+		    msg->header.datalen != sizeof(rpmi_uint32_t) ||
+		    ((rpmi_uint32_t *)msg->data)[0] != ~(base + i))
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Batches wrapping around the end of the queue and partial batches on a
+ * full or empty queue. Without batch callbacks, the transport falls back
+ * to the single message callbacks.
+ */
+static void test_batch_wrap(const char *name, rpmi_uint32_t flags,
+			    rpmi_bool_t batch_ops)
+{
+	struct rpmi_transport_queue_stats stats;
+	rpmi_uint32_t i, cap, batch, base = 0;
+	struct test_fixture fix = { 0 };
+	struct rpmi_message *msgs = NULL;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, flags, 0))
+		goto done;
+	if (!batch_ops) {
+		fix.xport->enqueue_batch = NULL;
+		fix.xport->dequeue_batch = NULL;
+	}
+
+	if (rpmi_transport_get_queue_stats(fix.xport, RPMI_QUEUE_A2P_REQ, &stats))
+		goto done;
+	cap = stats.capacity;
+	msgs = rpmi_env_zalloc((cap + 1) * TEST_BENCH_SLOT_SIZE);
+	if (!msgs)
+		goto done;
+
+	/* Only the free slots are filled and only pending messages are read */
+	test_batch_fill(fix.xport, msgs, cap + 1, base);
+	if (rpmi_transport_enqueue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+					 msgs, cap + 1) != cap ||
+	    rpmi_transport_enqueue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+					 msgs, 1) != 0)
+		goto done;
+	rpmi_env_memset(msgs, 0, (cap + 1) * TEST_BENCH_SLOT_SIZE);
+	if (rpmi_transport_dequeue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+					 msgs, cap + 1) != cap ||
+	    test_batch_check(fix.xport, msgs, cap, base) ||
+	    rpmi_transport_dequeue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+					 msgs, 1) != 0)
+		goto done;
+	base += cap;
+
+	/* Batches of two thirds of the capacity keep crossing the queue end */
+	batch = (2 * cap) / 3;
+	for (i = 0; i < 4; i++) {
+		test_batch_fill(fix.xport, msgs, batch, base);
+		if (rpmi_transport_enqueue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+						 msgs, batch) != batch)
+			goto done;
+		rpmi_env_memset(msgs, 0, batch * TEST_BENCH_SLOT_SIZE);
+		if (rpmi_transport_dequeue_batch(fix.xport, RPMI_QUEUE_A2P_REQ,
+						 msgs, batch) != batch ||
+		    test_batch_check(fix.xport, msgs, batch, base))
+			goto done;
+		base += batch;
+	}
+
+	if (!rpmi_transport_is_empty(fix.xport, RPMI_QUEUE_A2P_REQ))
+		goto done;
+
+	failed = 0;
+done:
+	test_report(name, failed);
+	test_fixture_teardown(&fix);
+	rpmi_env_free(msgs);
+}
+
+/* Peek and commit with and without directly addressable shared memory */
+static void test_peek_commit(void)
+{
+	struct test_fixture fix[2] = { { 0 }, { 0 } };
+	struct test_shmem_counters cnt = { 0 };
+	struct rpmi_message *slot;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix[0], &rpmi_shmem_simple_ops, NULL, 0, 0) ||
+	    test_fixture_setup(&fix[1], &test_shmem_count_ops, &cnt, 0, 0))
+		goto done;
+
+	/* Shared memory accessed through platform callbacks can't be peeked */
+	if (rpmi_transport_can_peek(fix[1].xport) ||
+	    test_post_requests(fix[1].xport, fix[1].msg, 1) ||
+	    rpmi_transport_peek_slot(fix[1].xport, RPMI_QUEUE_A2P_REQ, 0) ||
+	    rpmi_transport_commit_slot(fix[1].xport, RPMI_QUEUE_A2P_REQ, 1) !=
+	    RPMI_ERR_NOTSUPP)
+		goto done;
+
+	/* Pending requests are peeked from the head and released by commit */
+	if (!rpmi_transport_can_peek(fix[0].xport) ||
+	    rpmi_transport_peek_slot(fix[0].xport, RPMI_QUEUE_A2P_REQ, 0) ||
+	    test_post_requests(fix[0].xport, fix[0].msg, 2))
+		goto done;
+	slot = rpmi_transport_peek_slot(fix[0].xport, RPMI_QUEUE_A2P_REQ, 1);
+	if (!slot || rpmi_to_le16(slot->header.token) != 1 ||
+	    rpmi_transport_peek_slot(fix[0].xport, RPMI_QUEUE_A2P_REQ, 2) ||
+	    rpmi_transport_commit_slot(fix[0].xport, RPMI_QUEUE_A2P_REQ, 3) !=
+	    RPMI_ERR_INVALID_PARAM ||
+	    rpmi_transport_commit_slot(fix[0].xport, RPMI_QUEUE_A2P_REQ, 2) ||
+	    !rpmi_transport_is_empty(fix[0].xport, RPMI_QUEUE_A2P_REQ))
+		goto done;
+
+	/* Free acknowledgement slots are peeked from the tail */
+	slot = rpmi_transport_peek_slot(fix[0].xport, RPMI_QUEUE_P2A_ACK, 0);
+	if (!slot)
+		goto done;
+	rpmi_env_memset(slot, 0, TEST_BENCH_SLOT_SIZE);
+	slot->header.token = rpmi_to_le16(0x55);
+	if (!rpmi_transport_is_empty(fix[0].xport, RPMI_QUEUE_P2A_ACK) ||
+	    rpmi_transport_commit_slot(fix[0].xport, RPMI_QUEUE_P2A_ACK, 1) ||
+	    rpmi_transport_dequeue(fix[0].xport, RPMI_QUEUE_P2A_ACK, fix[0].msg) ||
+	    fix[0].msg->header.token != 0x55)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("Peek and commit of queue slots", failed);
+	test_fixture_teardown(&fix[0]);
+	test_fixture_teardown(&fix[1]);
+}
+
+/* Two transports (in-place and copy based) served by one context */
+static void test_multi_transport(void)
+{
+	struct test_shmem_counters cnt = { 0 };
+	struct test_fixture fix[2] = { { 0 }, { 0 } };
+	int failed = 1;
+
+	if (test_fixture_setup(&fix[0], &rpmi_shmem_simple_ops, NULL, 0, 2) ||
+	    test_fixture_setup(&fix[1], &test_shmem_count_ops, &cnt, 0, 0))
+		goto done;
+
+	if (rpmi_context_add_transport(fix[0].cntx, fix[1].xport, -1U) ||
+	    rpmi_context_add_transport(fix[0].cntx, fix[1].xport, -1U) !=
+	    RPMI_ERR_ALREADY)
+		goto done;
+
+	if (test_post_requests(fix[0].xport, fix[0].msg, 3) ||
+	    test_post_requests(fix[1].xport, fix[1].msg, 3))
+		goto done;
+
+	/* Budget of one request per transport */
+	if (rpmi_context_poll(fix[0].cntx, 1) != 2 ||
+	    test_count_acks(fix[0].xport, fix[0].msg) != 1 ||
+	    test_count_acks(fix[1].xport, fix[1].msg) != 1)
+		goto done;
+
+	/* Drain the remaining requests */
+	if (rpmi_context_poll(fix[0].cntx, 8) != 4 ||
+	    test_count_acks(fix[0].xport, fix[0].msg) != 2 ||
+	    test_count_acks(fix[1].xport, fix[1].msg) != 2)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("Multiple transports in one context", failed);
+
+	if (fix[0].cntx && fix[1].xport)
+		rpmi_context_remove_transport(fix[0].cntx, fix[1].xport);
+	test_fixture_teardown(&fix[0]);
+	test_fixture_teardown(&fix[1]);
+}
+
+/* Requests with a data length beyond the slot are rejected */
+static void test_oversized_request(const char *name,
+				   const struct rpmi_shmem_platform_ops *ops)
+{
+	struct test_shmem_counters cnt = { 0 };
+	struct test_fixture fix = { 0 };
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, ops, &cnt, 0, 2))
+		goto done;
+
+	rpmi_env_memset(fix.msg, 0, TEST_BENCH_SLOT_SIZE);
+	fix.msg->header.servicegroup_id = RPMI_SRVGRP_BASE;
+	fix.msg->header.service_id = RPMI_BASE_SRV_GET_IMPLEMENTATION_VERSION;
+	fix.msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+	fix.msg->header.datalen = TEST_BENCH_SLOT_SIZE;
+	fix.msg->header.token = 0x42;
+	if (rpmi_transport_enqueue(fix.xport, RPMI_QUEUE_A2P_REQ, fix.msg) ||
+	    test_post_requests(fix.xport, fix.msg, 1))
+		goto done;
+
+	rpmi_context_process_a2p_request(fix.cntx);
+
+	/* Oversized request is acknowledged with an error, the next one not */
+	if (rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_P2A_ACK, fix.msg) ||
+	    fix.msg->header.token != 0x42 ||
+	    fix.msg->header.datalen != sizeof(rpmi_uint32_t) ||
+	    ((rpmi_uint32_t *)fix.msg->data)[0] != (rpmi_uint32_t)RPMI_ERR_INVALID_PARAM ||
+	    test_count_acks(fix.xport, fix.msg) != 1)
+		goto done;
+
+	failed = 0;
+done:
+	test_report(name, failed);
+	test_fixture_teardown(&fix);
+}
+
+static enum rpmi_error test_dispatch_get(struct rpmi_service_group *group,
+					 struct rpmi_service *service,
+					 struct rpmi_transport *trans,
+					 rpmi_uint16_t request_datalen,
+					 const rpmi_uint8_t *request_data,
+					 rpmi_uint16_t *response_datalen,
+					 rpmi_uint8_t *response_data)
+{
+	((rpmi_uint32_t *)response_data)[0] = RPMI_SUCCESS;
+	*response_datalen = sizeof(rpmi_uint32_t);
+	return RPMI_SUCCESS;
+}
+
+static struct rpmi_service test_dispatch_services[] = {
+	{
+		.service_id = 0,
+		.min_a2p_request_datalen = 0,
+		.process_a2p_request = test_dispatch_get,
+	},
+};
+
+static rpmi_uint32_t test_dispatch_post(struct test_fixture *fix,
+					rpmi_uint16_t servicegroup_id)
+{
+	rpmi_env_memset(fix->msg, 0, TEST_BENCH_SLOT_SIZE);
+	fix->msg->header.servicegroup_id = servicegroup_id;
+	fix->msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+	if (rpmi_transport_enqueue(fix->xport, RPMI_QUEUE_A2P_REQ, fix->msg))
+		return (rpmi_uint32_t)-1;
+
+	rpmi_context_process_a2p_request(fix->cntx);
+
+	return test_count_acks(fix->xport, fix->msg);
+}
+
+#define TEST_DISPATCH_GROUP_COUNT	4
+
+/*
+ * Dispatch tables of standard, experimental and vendor service groups added
+ * and removed. The last vendor group is outside the direct-indexed tables.
+ */
+static void test_dispatch_tables(void)
+{
+	static const rpmi_uint16_t ids[TEST_DISPATCH_GROUP_COUNT] = {
+		RPMI_SRVGRP_RAS_AGENT,
+		RPMI_SRVGRP_EXPERIMENTAL_START,
+		RPMI_SRVGRP_VENDOR_START,
+		RPMI_SRVGRP_VENDOR_START + 0x100,
+	};
+	struct rpmi_service_group group[TEST_DISPATCH_GROUP_COUNT];
+	struct test_fixture fix = { 0 };
+	rpmi_uint32_t i, j;
+	int failed = 1;
+
+	rpmi_env_memset(group, 0, sizeof(group));
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0,
+			       TEST_DISPATCH_GROUP_COUNT + 1))
+		goto done;
+
+	for (i = 0; i < TEST_DISPATCH_GROUP_COUNT; i++) {
+		group[i].name = "dispatch_group";
+		group[i].servicegroup_id = ids[i];
+		group[i].max_service_id = 1;
+		group[i].privilege_level_bitmap = 1U << RPMI_PRIVILEGE_M_MODE;
+		group[i].services = test_dispatch_services;
+		if (rpmi_context_add_group(fix.cntx, &group[i]) ||
+		    rpmi_context_find_group(fix.cntx, ids[i]) != &group[i] ||
+		    test_dispatch_post(&fix, ids[i]) != 1)
+			goto done;
+	}
+
+	/* Neighbouring IDs of the tables are not found */
+	if (rpmi_context_find_group(fix.cntx, RPMI_SRVGRP_EXPERIMENTAL_START + 1) ||
+	    rpmi_context_find_group(fix.cntx, RPMI_SRVGRP_VENDOR_START + 1) ||
+	    rpmi_context_find_group(fix.cntx, RPMI_SRVGRP_VENDOR_START + 0x101))
+		goto done;
+
+	/* Requests to removed groups are dropped, other groups are unaffected */
+	for (i = 0; i < TEST_DISPATCH_GROUP_COUNT; i++) {
+		rpmi_context_remove_group(fix.cntx, &group[i]);
+		if (rpmi_context_find_group(fix.cntx, ids[i]))
+			goto done;
+		for (j = 0; j < TEST_DISPATCH_GROUP_COUNT; j++) {
+			if (test_dispatch_post(&fix, ids[j]) != (j > i))
+				goto done;
+		}
+	}
+
+	/* Removed groups can be added again with a fresh dispatch table */
+	for (i = 0; i < TEST_DISPATCH_GROUP_COUNT; i++) {
+		if (rpmi_context_add_group(fix.cntx, &group[i]) ||
+		    test_dispatch_post(&fix, ids[i]) != 1)
+			goto done;
+		rpmi_context_remove_group(fix.cntx, &group[i]);
+	}
+
+	failed = 0;
+done:
+	test_report("Dispatch tables of added and removed groups", failed);
+	if (fix.cntx) {
+		for (i = 0; i < TEST_DISPATCH_GROUP_COUNT; i++)
+			rpmi_context_remove_group(fix.cntx, &group[i]);
+	}
+	test_fixture_teardown(&fix);
+}
+
+static rpmi_bool_t test_doorbell_validate(void *priv, rpmi_uint64_t msi_addr)
+{
+	return true;
+}
+
+static const struct rpmi_sysmsi_platform_ops test_doorbell_sysmsi_ops = {
+	.validate_msi_addr = test_doorbell_validate,
+};
+
+/* Bitmap of system MSIs pending with MSI delivery disabled */
+static rpmi_uint32_t test_doorbell_pending(struct rpmi_context *cntx,
+					   struct rpmi_transport *xport,
+					   struct rpmi_message *msg,
+					   rpmi_uint32_t num_msi)
+{
+	rpmi_uint32_t i, *data = (void *)msg->data, pending = 0;
+
+	for (i = 0; i < num_msi; i++) {
+		rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+		msg->header.servicegroup_id = RPMI_SRVGRP_SYSTEM_MSI;
+		msg->header.service_id = RPMI_SYSMSI_SRV_GET_MSI_STATE;
+		msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+		msg->header.datalen = sizeof(rpmi_uint32_t);
+		data[0] = i;
+		if (rpmi_transport_enqueue(xport, RPMI_QUEUE_A2P_REQ, msg))
+			return -1U;
+		rpmi_context_process_a2p_request(cntx);
+		if (rpmi_transport_dequeue(xport, RPMI_QUEUE_P2A_ACK, msg) ||
+		    data[0] != RPMI_SUCCESS)
+			return -1U;
+		if (data[1] & RPMI_SYSMSI_MSI_STATE_PENDING)
+			pending |= 1U << i;
+	}
+
+	return pending;
+}
+
+static rpmi_uint32_t test_doorbell_request(struct rpmi_context *cntx,
+					   struct rpmi_transport *xport,
+					   struct rpmi_message *msg)
+{
+	rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+	msg->header.servicegroup_id = RPMI_SRVGRP_BASE;
+	msg->header.service_id = RPMI_BASE_SRV_GET_IMPLEMENTATION_VERSION;
+	msg->header.flags = RPMI_MSG_NORMAL_REQUEST | RPMI_MSG_FLAGS_DOORBELL;
+	if (rpmi_transport_enqueue(xport, RPMI_QUEUE_A2P_REQ, msg))
+		return 0;
+
+	rpmi_context_process_a2p_request(cntx);
+
+	return test_count_acks(xport, msg);
+}
+
+/* Acknowledgements ring the P2A doorbell of the transport they are sent on */
+static void test_transport_doorbell(void)
+{
+	struct test_fixture fix[2] = { { 0 }, { 0 } };
+	struct rpmi_service_group *sysmsi = NULL;
+	struct rpmi_context *cntx;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix[0], &rpmi_shmem_simple_ops, NULL, 0, 2) ||
+	    test_fixture_setup(&fix[1], &rpmi_shmem_simple_ops, NULL, 0, 0))
+		goto done;
+	cntx = fix[0].cntx;
+
+	/* MSI 0 is the doorbell of the primary transport and MSI 1 of the other */
+	sysmsi = rpmi_service_group_sysmsi_create(3, 0, &test_doorbell_sysmsi_ops,
+						  NULL);
+	if (!sysmsi || rpmi_context_add_group(cntx, sysmsi) ||
+	    rpmi_context_add_transport(cntx, fix[1].xport, 1))
+		goto done;
+
+	if (test_doorbell_request(cntx, fix[1].xport, fix[1].msg) != 1 ||
+	    test_doorbell_pending(cntx, fix[1].xport, fix[1].msg, 3) != (1U << 1))
+		goto done;
+
+	if (test_doorbell_request(cntx, fix[0].xport, fix[0].msg) != 1 ||
+	    test_doorbell_pending(cntx, fix[0].xport, fix[0].msg, 3) !=
+	    ((1U << 0) | (1U << 1)))
+		goto done;
+
+	failed = 0;
+done:
+	test_report("P2A doorbell per transport", failed);
+	if (fix[0].cntx) {
+		if (fix[1].xport)
+			rpmi_context_remove_transport(fix[0].cntx, fix[1].xport);
+		if (sysmsi)
+			rpmi_context_remove_group(fix[0].cntx, sysmsi);
+	}
+	if (sysmsi)
+		rpmi_service_group_sysmsi_destroy(sysmsi);
+	test_fixture_teardown(&fix[0]);
+	test_fixture_teardown(&fix[1]);
+}
+
+/* Bounded request processing with a budget */
+static void test_request_budget(void)
+{
+	struct rpmi_service_stats stats;
+	struct test_fixture fix = { 0 };
+	rpmi_uint32_t processed;
+	enum rpmi_error rc;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0, 2))
+		goto done;
+
+	if (test_post_requests(fix.xport, fix.msg, 5))
+		goto done;
+
+	if (rpmi_context_process_a2p_request_budget(fix.cntx, 2, &processed) ||
+	    processed != 2 || test_count_acks(fix.xport, fix.msg) != 2)
+		goto done;
+
+	if (rpmi_context_process_a2p_request_budget(fix.cntx, 8, &processed) ||
+	    processed != 3 || test_count_acks(fix.xport, fix.msg) != 3)
+		goto done;
+
+	if (rpmi_context_process_a2p_request_budget(fix.cntx, 8, &processed) ||
+	    processed != 0)
+		goto done;
+
+	/* Statistics are available only with LIBRPMI_STATS */
+	rc = rpmi_context_get_stats(fix.cntx, RPMI_SRVGRP_BASE,
+				    RPMI_BASE_SRV_GET_IMPLEMENTATION_VERSION,
+				    &stats);
+	if (rc == RPMI_SUCCESS) {
+		if (stats.request_count != 5 || stats.error_count ||
+		    stats.notsupp_count ||
+		    stats.min_latency > stats.max_latency)
+			goto done;
+	} else if (rc != RPMI_ERR_NOTSUPP) {
+		goto done;
+	}
+
+	failed = 0;
+done:
+	test_report("Request processing budget", failed);
+	test_fixture_teardown(&fix);
+}
+
+static void test_context_run(void)
+{
+	struct test_fixture fix = { 0 };
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0, 2))
+		goto done;
+
+	if (test_post_requests(fix.xport, fix.msg, 3))
+		goto done;
+
+	/* Requests signalled together with stop are processed before return */
+	rpmi_context_signal(fix.cntx, LIBRPMI_CONTEXT_SIGNAL_A2P |
+				      LIBRPMI_CONTEXT_SIGNAL_STOP);
+	rpmi_context_run(fix.cntx);
+	if (test_count_acks(fix.xport, fix.msg) != 3)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("Context run loop", failed);
+	test_fixture_teardown(&fix);
+}
+
+/*
+ * Requests held back by a full P2A acknowledgement queue are processed
+ * once the application processor drains it without signalling again
+ */
+static void test_run_backpressure(const char *name,
+				  const struct rpmi_shmem_platform_ops *ops)
+{
+	struct rpmi_transport_queue_stats stats;
+	struct test_shmem_counters cnt = { 0 };
+	struct test_fixture fix = { 0 };
+	rpmi_uint32_t cap;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, ops, &cnt, 0, 2) ||
+	    rpmi_transport_get_queue_stats(fix.xport, RPMI_QUEUE_P2A_ACK, &stats))
+		goto done;
+	cap = stats.capacity;
+
+	/* Fill the P2A acknowledgement queue */
+	if (test_post_requests(fix.xport, fix.msg, cap))
+		goto done;
+	rpmi_context_signal(fix.cntx, LIBRPMI_CONTEXT_SIGNAL_A2P);
+	if (rpmi_context_process_signalled(fix.cntx))
+		goto done;
+
+	if (test_post_requests(fix.xport, fix.msg, 3))
+		goto done;
+	rpmi_context_signal(fix.cntx, LIBRPMI_CONTEXT_SIGNAL_A2P);
+	if (rpmi_context_process_signalled(fix.cntx) != LIBRPMI_CONTEXT_SIGNAL_A2P)
+		goto done;
+
+	/* Draining the acknowledgements doesn't signal the context */
+	if (test_count_acks(fix.xport, fix.msg) != cap ||
+	    rpmi_context_process_signalled(fix.cntx) ||
+	    test_count_acks(fix.xport, fix.msg) != 3)
+		goto done;
+
+	failed = 0;
+done:
+	test_report(name, failed);
+	test_fixture_teardown(&fix);
+}
+
+static enum rpmi_error test_count_events(struct rpmi_service_group *group)
+{
+	rpmi_uint32_t *calls = group->priv;
+
+	/* First call finds the hardware busy */
+	return ((*calls)++) ? RPMI_SUCCESS : RPMI_ERR_BUSY;
+}
+
+static void test_pending_events(void)
+{
+	struct rpmi_service_group group = { 0 };
+	struct test_fixture fix = { 0 };
+	rpmi_uint32_t calls = 0;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0, 2))
+		goto done;
+
+	group.name = "events_group";
+	group.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+	group.privilege_level_bitmap = 1U << RPMI_PRIVILEGE_M_MODE;
+	group.process_events = test_count_events;
+	group.priv = &calls;
+	if (rpmi_context_add_group(fix.cntx, &group))
+		goto done;
+
+	/* Only pending groups are processed without the sweep */
+	rpmi_context_set_event_sweep_period(fix.cntx, 0);
+	rpmi_context_process_all_events(fix.cntx);
+	if (calls != 0)
+		goto done;
+
+	/* Busy group remains pending until processed successfully */
+	if (rpmi_context_mark_group_pending(fix.cntx, RPMI_SRVGRP_VENDOR_START))
+		goto done;
+	rpmi_context_process_all_events(fix.cntx);
+	rpmi_context_process_all_events(fix.cntx);
+	rpmi_context_process_all_events(fix.cntx);
+	if (calls != 2)
+		goto done;
+
+	/* Every second call sweeps all groups */
+	rpmi_context_set_event_sweep_period(fix.cntx, 2);
+	rpmi_context_process_all_events(fix.cntx);
+	rpmi_context_process_all_events(fix.cntx);
+	if (calls != 3)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("Pending service group events", failed);
+
+	if (fix.cntx)
+		rpmi_context_remove_group(fix.cntx, &group);
+	test_fixture_teardown(&fix);
+}
+
+/* Vendor service group with a posted "set" service and a normal "get" service */
+struct test_coalesce_state {
+	rpmi_uint32_t executed;
+	rpmi_uint32_t value[2];
+};
+
+static enum rpmi_error test_coalesce_set(struct rpmi_service_group *group,
+					 struct rpmi_service *service,
+					 struct rpmi_transport *trans,
+					 rpmi_uint16_t request_datalen,
+					 const rpmi_uint8_t *request_data,
+					 rpmi_uint16_t *response_datalen,
+					 rpmi_uint8_t *response_data)
+{
+	struct test_coalesce_state *state = group->priv;
+	const rpmi_uint32_t *req = (const void *)request_data;
+
+	state->executed++;
+	state->value[req[0] & 1] = req[1];
+	*response_datalen = 0;
+	return RPMI_SUCCESS;
+}
+
+static enum rpmi_error test_coalesce_get(struct rpmi_service_group *group,
+					 struct rpmi_service *service,
+					 struct rpmi_transport *trans,
+					 rpmi_uint16_t request_datalen,
+					 const rpmi_uint8_t *request_data,
+					 rpmi_uint16_t *response_datalen,
+					 rpmi_uint8_t *response_data)
+{
+	*response_datalen = 0;
+	return RPMI_SUCCESS;
+}
+
+static struct rpmi_service test_coalesce_services[] = {
+	{
+		.service_id = 0,
+		.min_a2p_request_datalen = 8,
+		.coalesce_key_len = 4,
+		.process_a2p_request = test_coalesce_set,
+	},
+	{
+		.service_id = 1,
+		.min_a2p_request_datalen = 0,
+		.process_a2p_request = test_coalesce_get,
+	},
+};
+
+static int test_coalesce_post(struct rpmi_transport *xport,
+			      struct rpmi_message *msg, rpmi_uint8_t service_id,
+			      rpmi_uint32_t key, rpmi_uint32_t value)
+{
+	rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+	msg->header.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+	msg->header.service_id = service_id;
+	msg->header.flags = service_id ? RPMI_MSG_NORMAL_REQUEST :
+					 RPMI_MSG_POSTED_REQUEST;
+	msg->header.datalen = 8;
+	((rpmi_uint32_t *)msg->data)[0] = key;
+	((rpmi_uint32_t *)msg->data)[1] = value;
+
+	return rpmi_transport_enqueue(xport, RPMI_QUEUE_A2P_REQ, msg) ? -1 : 0;
+}
+
+static void test_coalesce(const char *name,
+			  const struct rpmi_shmem_platform_ops *ops)
+{
+	struct test_shmem_counters cnt = { 0 };
+	struct test_coalesce_state state = { 0 };
+	struct rpmi_service_group group = { 0 };
+	struct test_fixture fix = { 0 };
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, ops, &cnt, 0, 2))
+		goto done;
+
+	group.name = "coalesce_group";
+	group.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+	group.max_service_id = 2;
+	group.privilege_level_bitmap = 1U << RPMI_PRIVILEGE_M_MODE;
+	group.services = test_coalesce_services;
+	group.priv = &state;
+	if (rpmi_context_add_group(fix.cntx, &group))
+		goto done;
+	rpmi_context_set_coalescing(fix.cntx, true);
+
+	/* Only the last posted request to each target is executed */
+	if (test_coalesce_post(fix.xport, fix.msg, 0, 0, 1) ||
+	    test_coalesce_post(fix.xport, fix.msg, 0, 1, 1) ||
+	    test_coalesce_post(fix.xport, fix.msg, 0, 0, 2) ||
+	    test_coalesce_post(fix.xport, fix.msg, 0, 0, 3))
+		goto done;
+	rpmi_context_process_a2p_request(fix.cntx);
+	if (state.executed != 2 || state.value[0] != 3 || state.value[1] != 1 ||
+	    rpmi_context_superseded_count(fix.cntx) != 2)
+		goto done;
+
+	/* Other request to the same group in between prevents coalescing */
+	if (test_coalesce_post(fix.xport, fix.msg, 0, 0, 4) ||
+	    test_coalesce_post(fix.xport, fix.msg, 1, 0, 0) ||
+	    test_coalesce_post(fix.xport, fix.msg, 0, 0, 5))
+		goto done;
+	rpmi_context_process_a2p_request(fix.cntx);
+	if (state.executed != 4 || state.value[0] != 5 ||
+	    rpmi_context_superseded_count(fix.cntx) != 2 ||
+	    test_count_acks(fix.xport, fix.msg) != 1)
+		goto done;
+
+	failed = 0;
+done:
+	test_report(name, failed);
+
+	if (fix.cntx)
+		rpmi_context_remove_group(fix.cntx, &group);
+	test_fixture_teardown(&fix);
+}
+
+/* Vendor service whose acknowledgement is completed later by the test */
+static struct rpmi_context *test_deferred_cntx;
+static rpmi_uint32_t test_deferred_token;
+
+static enum rpmi_error test_deferred_start(struct rpmi_service_group *group,
+					   struct rpmi_service *service,
+					   struct rpmi_transport *trans,
+					   rpmi_uint16_t request_datalen,
+					   const rpmi_uint8_t *request_data,
+					   rpmi_uint16_t *response_datalen,
+					   rpmi_uint8_t *response_data)
+{
+	*response_datalen = 0;
+	return rpmi_context_defer_request(test_deferred_cntx,
+					  &test_deferred_token);
+}
+
+static struct rpmi_service test_deferred_services[] = {
+	{
+		.service_id = 0,
+		.min_a2p_request_datalen = 0,
+		.process_a2p_request = test_deferred_start,
+	},
+	{
+		.service_id = 1,
+		.min_a2p_request_datalen = 0,
+		.process_a2p_request = test_coalesce_get,
+	},
+};
+
+static void test_deferred(void)
+{
+	rpmi_uint32_t resp[2] = { RPMI_SUCCESS, 0x1234 };
+	struct rpmi_service_group group = { 0 };
+	struct test_fixture fix = { 0 };
+	struct rpmi_message *msg;
+	rpmi_uint32_t i, token;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0, 2))
+		goto done;
+	msg = fix.msg;
+	test_deferred_cntx = fix.cntx;
+
+	group.name = "deferred_group";
+	group.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+	group.max_service_id = 2;
+	group.privilege_level_bitmap = 1U << RPMI_PRIVILEGE_M_MODE;
+	group.services = test_deferred_services;
+	if (rpmi_context_add_group(fix.cntx, &group))
+		goto done;
+
+	/* Deferring is only possible from within a service handler */
+	if (rpmi_context_defer_request(fix.cntx, &token) != RPMI_ERR_INVALID_STATE)
+		goto done;
+
+	/* Only the request which is not deferred is acknowledged */
+	for (i = 0; i < 2; i++) {
+		rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+		msg->header.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+		msg->header.service_id = i;
+		msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+		msg->header.token = 0x10 + i;
+		if (rpmi_transport_enqueue(fix.xport, RPMI_QUEUE_A2P_REQ, msg))
+			goto done;
+	}
+	rpmi_context_process_a2p_request(fix.cntx);
+	if (test_count_acks(fix.xport, msg) != 1)
+		goto done;
+
+	/* Completion sends the response from the next processing call */
+	if (rpmi_context_complete_request(fix.cntx, test_deferred_token,
+					  resp, sizeof(resp)))
+		goto done;
+	rpmi_context_process_a2p_request(fix.cntx);
+	if (rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    msg->header.token != 0x10 || msg->header.service_id != 0 ||
+	    msg->header.datalen != sizeof(resp) ||
+	    ((rpmi_uint32_t *)msg->data)[1] != resp[1] ||
+	    !rpmi_transport_is_empty(fix.xport, RPMI_QUEUE_P2A_ACK))
+		goto done;
+
+	/* Token can't be completed twice */
+	if (rpmi_context_complete_request(fix.cntx, test_deferred_token,
+					  resp, sizeof(resp)) !=
+	    RPMI_ERR_INVALID_PARAM)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("Deferred request completion", failed);
+
+	test_deferred_cntx = NULL;
+	if (fix.cntx)
+		rpmi_context_remove_group(fix.cntx, &group);
+	test_fixture_teardown(&fix);
+}
+
+/* Deferred request tokens stay valid across the generation wrap-around */
+static void test_deferred_wrap(void)
+{
+	rpmi_uint32_t resp[2] = { RPMI_SUCCESS, 0x5678 };
+	struct rpmi_service_group group = { 0 };
+	struct test_fixture fix = { 0 };
+	rpmi_uint32_t i, stale = 0;
+	struct rpmi_message *msg;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0, 2))
+		goto done;
+	msg = fix.msg;
+	test_deferred_cntx = fix.cntx;
+
+	group.name = "deferred_group";
+	group.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+	group.max_service_id = 2;
+	group.privilege_level_bitmap = 1U << RPMI_PRIVILEGE_M_MODE;
+	group.services = test_deferred_services;
+	if (rpmi_context_add_group(fix.cntx, &group))
+		goto done;
+
+	/* Generation of the first entry goes 0xfffffe, 0xffffff, 0, 1 */
+	rpmi_context_set_deferred_generation(fix.cntx, 0xfffffe);
+	for (i = 0; i < 4; i++) {
+		rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+		msg->header.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+		msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+		msg->header.token = i;
+		if (rpmi_transport_enqueue(fix.xport, RPMI_QUEUE_A2P_REQ, msg))
+			goto done;
+		rpmi_context_process_a2p_request(fix.cntx);
+		if (i && test_deferred_token == stale)
+			goto done;
+
+		/* Token of the previous use of the entry is stale */
+		if (i && rpmi_context_complete_request(fix.cntx, stale, resp,
+						       sizeof(resp)) !=
+		    RPMI_ERR_INVALID_PARAM)
+			goto done;
+
+		if (rpmi_context_complete_request(fix.cntx, test_deferred_token,
+						  resp, sizeof(resp)))
+			goto done;
+		rpmi_context_process_a2p_request(fix.cntx);
+		if (rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_P2A_ACK, msg) ||
+		    msg->header.token != i ||
+		    ((rpmi_uint32_t *)msg->data)[1] != resp[1])
+			goto done;
+		stale = test_deferred_token;
+	}
+
+	failed = 0;
+done:
+	test_report("Deferred request generation wrap-around", failed);
+
+	test_deferred_cntx = NULL;
+	if (fix.cntx)
+		rpmi_context_remove_group(fix.cntx, &group);
+	test_fixture_teardown(&fix);
+}
+
+/* Vendor service group raising notification events 1 and 2 */
+static struct rpmi_service test_notify_services[] = {
+	{
+		.service_id = 0,
+		.min_a2p_request_datalen = 0,
+		.process_a2p_request = test_coalesce_get,
+	},
+	{
+		.service_id = RPMI_BASE_SRV_ENABLE_NOTIFICATION,
+		.min_a2p_request_datalen = 8,
+		.process_a2p_request = NULL,
+	},
+};
+
+static int test_notify_enable(struct rpmi_transport *xport,
+			      struct rpmi_message *msg, rpmi_uint32_t event_id,
+			      rpmi_uint32_t state)
+{
+	rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+	msg->header.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+	msg->header.service_id = RPMI_BASE_SRV_ENABLE_NOTIFICATION;
+	msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+	msg->header.datalen = 8;
+	((rpmi_uint32_t *)msg->data)[0] = event_id;
+	((rpmi_uint32_t *)msg->data)[1] = state;
+	if (rpmi_transport_enqueue(xport, RPMI_QUEUE_A2P_REQ, msg))
+		return -1;
+
+	return 0;
+}
+
+static void test_notifications(void)
+{
+	rpmi_uint32_t ev_data[2] = { 0x11, 0x22 };
+	struct rpmi_service_group group = { 0 };
+	struct test_fixture fix = { 0 };
+	struct rpmi_message *msg;
+	rpmi_uint32_t *data;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0, 2))
+		goto done;
+	msg = fix.msg;
+	data = (void *)msg->data;
+
+	group.name = "notify_group";
+	group.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+	group.max_service_id = 2;
+	group.privilege_level_bitmap = 1U << RPMI_PRIVILEGE_M_MODE;
+	group.services = test_notify_services;
+	group.notification_events = (1U << 1) | (1U << 2);
+	if (rpmi_context_add_group(fix.cntx, &group))
+		goto done;
+
+	/* Events not enabled are dropped and unsupported events rejected */
+	if (rpmi_context_queue_notification(fix.cntx, RPMI_SRVGRP_VENDOR_START,
+					    1, NULL, 0) ||
+	    rpmi_context_queue_notification(fix.cntx, RPMI_SRVGRP_VENDOR_START,
+					    3, NULL, 0) != RPMI_ERR_NOTSUPP)
+		goto done;
+	rpmi_context_process_all_events(fix.cntx);
+	if (!rpmi_transport_is_empty(fix.xport, RPMI_QUEUE_P2A_REQ))
+		goto done;
+
+	/* Enable event 1 and check its state, event 3 is not supported */
+	if (test_notify_enable(fix.xport, msg, 1, RPMI_NOTIF_STATE_ENABLE) ||
+	    test_notify_enable(fix.xport, msg, 1, RPMI_NOTIF_STATE_RETURN) ||
+	    test_notify_enable(fix.xport, msg, 3, RPMI_NOTIF_STATE_ENABLE))
+		goto done;
+	rpmi_context_process_a2p_request(fix.cntx);
+	if (rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != RPMI_SUCCESS || data[1] != RPMI_NOTIF_STATE_ENABLE ||
+	    rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != RPMI_SUCCESS || data[1] != RPMI_NOTIF_STATE_ENABLE ||
+	    rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_P2A_ACK, msg) ||
+	    data[0] != (rpmi_uint32_t)RPMI_ERR_NOTSUPP)
+		goto done;
+
+	/* Enabled events are batched in one notification message */
+	if (rpmi_context_queue_notification(fix.cntx, RPMI_SRVGRP_VENDOR_START,
+					    1, NULL, 0) ||
+	    rpmi_context_queue_notification(fix.cntx, RPMI_SRVGRP_VENDOR_START,
+					    2, ev_data, 2) ||
+	    rpmi_context_queue_notification(fix.cntx, RPMI_SRVGRP_VENDOR_START,
+					    1, ev_data, 2))
+		goto done;
+	rpmi_context_process_all_events(fix.cntx);
+	if (rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_P2A_REQ, msg) ||
+	    msg->header.flags != RPMI_MSG_NOTIFICATION ||
+	    msg->header.servicegroup_id != RPMI_SRVGRP_VENDOR_START ||
+	    msg->header.datalen != 4 * sizeof(rpmi_uint32_t) ||
+	    data[0] != RPMI_NOTIF_EVENT_HDR(1, 0) ||
+	    data[1] != RPMI_NOTIF_EVENT_HDR(1, 8) ||
+	    data[2] != ev_data[0] || data[3] != ev_data[1] ||
+	    !rpmi_transport_is_empty(fix.xport, RPMI_QUEUE_P2A_REQ))
+		goto done;
+
+	failed = 0;
+done:
+	test_report("Notification events", failed);
+
+	if (fix.cntx)
+		rpmi_context_remove_group(fix.cntx, &group);
+	test_fixture_teardown(&fix);
+}
+
+/* Events are enabled and sent separately for each transport of a context */
+static void test_notifications_multi_transport(void)
+{
+	struct test_fixture fix[3] = { { 0 }, { 0 }, { 0 } };
+	struct test_shmem_counters cnt = { 0 };
+	rpmi_uint32_t ev_data[2] = { 0x11, 0x22 };
+	struct rpmi_service_group group = { 0 };
+	struct rpmi_context *cntx = NULL;
+	rpmi_uint32_t *data;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix[0], &rpmi_shmem_simple_ops, NULL, 0, 2) ||
+	    test_fixture_setup(&fix[1], &test_shmem_count_ops, &cnt, 0, 0) ||
+	    test_fixture_setup(&fix[2], &rpmi_shmem_simple_ops, NULL, 0, 0))
+		goto done;
+	cntx = fix[0].cntx;
+
+	group.name = "notify_group";
+	group.servicegroup_id = RPMI_SRVGRP_VENDOR_START;
+	group.max_service_id = 2;
+	group.privilege_level_bitmap = 1U << RPMI_PRIVILEGE_M_MODE;
+	group.services = test_notify_services;
+	group.notification_events = (1U << 1) | (1U << 2);
+	if (rpmi_context_add_group(cntx, &group) ||
+	    rpmi_context_add_transport(cntx, fix[1].xport, -1U) ||
+	    rpmi_context_add_transport(cntx, fix[2].xport, -1U))
+		goto done;
+
+	/* Event 1 on the first, both on the second and event 2 on the third */
+	if (test_notify_enable(fix[0].xport, fix[0].msg, 1,
+			       RPMI_NOTIF_STATE_ENABLE) ||
+	    test_notify_enable(fix[1].xport, fix[1].msg, 1,
+			       RPMI_NOTIF_STATE_ENABLE) ||
+	    test_notify_enable(fix[1].xport, fix[1].msg, 2,
+			       RPMI_NOTIF_STATE_ENABLE) ||
+	    test_notify_enable(fix[2].xport, fix[2].msg, 2,
+			       RPMI_NOTIF_STATE_ENABLE))
+		goto done;
+	if (rpmi_context_poll(cntx, 8) != 4 ||
+	    test_count_acks(fix[0].xport, fix[0].msg) != 1 ||
+	    test_count_acks(fix[1].xport, fix[1].msg) != 2 ||
+	    test_count_acks(fix[2].xport, fix[2].msg) != 1)
+		goto done;
+
+	/* Each transport gets one message with only the events it enabled */
+	if (rpmi_context_queue_notification(cntx, RPMI_SRVGRP_VENDOR_START,
+					    1, NULL, 0) ||
+	    rpmi_context_queue_notification(cntx, RPMI_SRVGRP_VENDOR_START,
+					    2, ev_data, 2))
+		goto done;
+	rpmi_context_process_all_events(cntx);
+	data = (void *)fix[0].msg->data;
+	if (rpmi_transport_dequeue(fix[0].xport, RPMI_QUEUE_P2A_REQ, fix[0].msg) ||
+	    fix[0].msg->header.flags != RPMI_MSG_NOTIFICATION ||
+	    fix[0].msg->header.datalen != sizeof(rpmi_uint32_t) ||
+	    data[0] != RPMI_NOTIF_EVENT_HDR(1, 0) ||
+	    !rpmi_transport_is_empty(fix[0].xport, RPMI_QUEUE_P2A_REQ))
+		goto done;
+	data = (void *)fix[1].msg->data;
+	if (rpmi_transport_dequeue(fix[1].xport, RPMI_QUEUE_P2A_REQ, fix[1].msg) ||
+	    fix[1].msg->header.flags != RPMI_MSG_NOTIFICATION ||
+	    fix[1].msg->header.datalen != 4 * sizeof(rpmi_uint32_t) ||
+	    data[0] != RPMI_NOTIF_EVENT_HDR(1, 0) ||
+	    data[1] != RPMI_NOTIF_EVENT_HDR(2, 8) ||
+	    data[2] != ev_data[0] || data[3] != ev_data[1] ||
+	    !rpmi_transport_is_empty(fix[1].xport, RPMI_QUEUE_P2A_REQ))
+		goto done;
+	data = (void *)fix[2].msg->data;
+	if (rpmi_transport_dequeue(fix[2].xport, RPMI_QUEUE_P2A_REQ, fix[2].msg) ||
+	    fix[2].msg->header.flags != RPMI_MSG_NOTIFICATION ||
+	    fix[2].msg->header.datalen != 3 * sizeof(rpmi_uint32_t) ||
+	    data[0] != RPMI_NOTIF_EVENT_HDR(2, 8) ||
+	    data[1] != ev_data[0] || data[2] != ev_data[1] ||
+	    !rpmi_transport_is_empty(fix[2].xport, RPMI_QUEUE_P2A_REQ))
+		goto done;
+
+	/* Disabling on one transport leaves the others subscribed */
+	if (test_notify_enable(fix[1].xport, fix[1].msg, 1,
+			       RPMI_NOTIF_STATE_DISABLE))
+		goto done;
+	data = (void *)fix[1].msg->data;
+	if (rpmi_context_poll(cntx, 8) != 1 ||
+	    rpmi_transport_dequeue(fix[1].xport, RPMI_QUEUE_P2A_ACK, fix[1].msg) ||
+	    data[0] != RPMI_SUCCESS || data[1] != RPMI_NOTIF_STATE_DISABLE)
+		goto done;
+	if (rpmi_context_queue_notification(cntx, RPMI_SRVGRP_VENDOR_START,
+					    1, NULL, 0))
+		goto done;
+	rpmi_context_process_all_events(cntx);
+	if (rpmi_transport_dequeue(fix[0].xport, RPMI_QUEUE_P2A_REQ, fix[0].msg) ||
+	    !rpmi_transport_is_empty(fix[1].xport, RPMI_QUEUE_P2A_REQ) ||
+	    !rpmi_transport_is_empty(fix[2].xport, RPMI_QUEUE_P2A_REQ))
+		goto done;
+
+	/* Subscriptions of later transports survive removal of an earlier one */
+	rpmi_context_remove_transport(cntx, fix[1].xport);
+	if (rpmi_context_queue_notification(cntx, RPMI_SRVGRP_VENDOR_START,
+					    2, ev_data, 2))
+		goto done;
+	rpmi_context_process_all_events(cntx);
+	data = (void *)fix[2].msg->data;
+	if (!rpmi_transport_is_empty(fix[0].xport, RPMI_QUEUE_P2A_REQ) ||
+	    !rpmi_transport_is_empty(fix[1].xport, RPMI_QUEUE_P2A_REQ) ||
+	    rpmi_transport_dequeue(fix[2].xport, RPMI_QUEUE_P2A_REQ, fix[2].msg) ||
+	    data[0] != RPMI_NOTIF_EVENT_HDR(2, 8))
+		goto done;
+
+	failed = 0;
+done:
+	test_report("Notification events per transport", failed);
+
+	if (cntx) {
+		rpmi_context_remove_group(cntx, &group);
+		rpmi_context_remove_transport(cntx, fix[1].xport);
+		rpmi_context_remove_transport(cntx, fix[2].xport);
+	}
+	test_fixture_teardown(&fix[0]);
+	test_fixture_teardown(&fix[1]);
+	test_fixture_teardown(&fix[2]);
+}
+
+/* Execution order of requests recorded by the priority test services */
+struct test_priority_log {
+	rpmi_uint32_t count;
+	rpmi_uint16_t tokens[8];
+};
+
+static struct test_priority_log test_priority_log;
+
+static enum rpmi_error test_priority_record(struct rpmi_service_group *group,
+					    struct rpmi_service *service,
+					    struct rpmi_transport *trans,
+					    rpmi_uint16_t request_datalen,
+					    const rpmi_uint8_t *request_data,
+					    rpmi_uint16_t *response_datalen,
+					    rpmi_uint8_t *response_data)
+{
+	struct test_priority_log *log = &test_priority_log;
+
+	if (log->count < TEST_ARRAY_SIZE(log->tokens))
+		log->tokens[log->count++] = ((const rpmi_uint32_t *)request_data)[0];
+	*response_datalen = 0;
+	return RPMI_SUCCESS;
+}
+
+static struct rpmi_service test_priority_services[] = {
+	{
+		.service_id = 0,
+		.min_a2p_request_datalen = 4,
+		.process_a2p_request = test_priority_record,
+	},
+};
+
+static void test_priority(const char *name,
+			  const struct rpmi_shmem_platform_ops *ops)
+{
+	/* Requests to normal (N) and high (H) priority groups: N N H N H */
+	static const rpmi_bool_t is_high[] = { false, false, true, false, true };
+	static const rpmi_uint16_t order[] = { 2, 4, 0, 1, 3 };
+	struct rpmi_service_group groups[2] = { { 0 }, { 0 } };
+	struct test_shmem_counters cnt = { 0 };
+	struct test_fixture fix = { 0 };
+	struct rpmi_message *msg;
+	rpmi_uint32_t i;
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, ops, &cnt, 0, 3))
+		goto done;
+	msg = fix.msg;
+
+	for (i = 0; i < TEST_ARRAY_SIZE(groups); i++) {
+		groups[i].name = "priority_group";
+		groups[i].servicegroup_id = RPMI_SRVGRP_VENDOR_START + i;
+		groups[i].max_service_id = TEST_ARRAY_SIZE(test_priority_services);
+		groups[i].priority = i ? RPMI_SRVGRP_PRIORITY_HIGH :
+					 RPMI_SRVGRP_PRIORITY_NORMAL;
+		groups[i].privilege_level_bitmap = RPMI_PRIVILEGE_M_MODE_MASK;
+		groups[i].services = test_priority_services;
+		if (rpmi_context_add_group(fix.cntx, &groups[i]))
+			goto done;
+	}
+
+	for (i = 0; i < TEST_ARRAY_SIZE(is_high); i++) {
+		rpmi_env_memset(msg, 0, TEST_BENCH_SLOT_SIZE);
+		msg->header.servicegroup_id = RPMI_SRVGRP_VENDOR_START + is_high[i];
+		msg->header.flags = RPMI_MSG_NORMAL_REQUEST;
+		msg->header.datalen = 4;
+		msg->header.token = i;
+		((rpmi_uint32_t *)msg->data)[0] = i;
+		if (rpmi_transport_enqueue(fix.xport, RPMI_QUEUE_A2P_REQ, msg))
+			goto done;
+	}
+
+	test_priority_log.count = 0;
+	rpmi_context_process_a2p_request(fix.cntx);
+	if (test_priority_log.count != TEST_ARRAY_SIZE(order) ||
+	    test_count_acks(fix.xport, msg) != TEST_ARRAY_SIZE(order))
+		goto done;
+	for (i = 0; i < TEST_ARRAY_SIZE(order); i++) {
+		if (test_priority_log.tokens[i] != order[i])
+			goto done;
+	}
+
+	failed = 0;
+done:
+	test_report(name, failed);
+
+	if (fix.cntx) {
+		for (i = 0; i < TEST_ARRAY_SIZE(groups); i++)
+			rpmi_context_remove_group(fix.cntx, &groups[i]);
+	}
+	test_fixture_teardown(&fix);
+}
+
+static void test_queue_stats(void)
+{
+	struct rpmi_transport_queue_stats stats;
+	rpmi_uint32_t i, count = 0;
+	struct test_fixture fix = { 0 };
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, &rpmi_shmem_simple_ops, NULL, 0, 0))
+		goto done;
+
+	/* Fill the queue and get rejected once */
+	while (!test_post_requests(fix.xport, fix.msg, 1))
+		count++;
+
+	if (rpmi_transport_get_queue_stats(fix.xport, RPMI_QUEUE_A2P_REQ, &stats) ||
+	    stats.capacity != count || stats.depth != count ||
+	    stats.high_water_mark != count || stats.full_count != 1 ||
+	    stats.enqueue_count != count || stats.dequeue_count)
+		goto done;
+
+	/* Drain the queue and find it empty once */
+	for (i = 0; i < count; i++) {
+		if (rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_A2P_REQ, fix.msg))
+			goto done;
+	}
+	if (rpmi_transport_dequeue(fix.xport, RPMI_QUEUE_A2P_REQ, fix.msg) !=
+	    RPMI_ERR_IO)
+		goto done;
+
+	if (rpmi_transport_get_queue_stats(fix.xport, RPMI_QUEUE_A2P_REQ, &stats) ||
+	    stats.depth || stats.high_water_mark != count ||
+	    stats.empty_count != 1 || stats.dequeue_count != count)
+		goto done;
+
+	failed = 0;
+done:
+	test_report("Queue occupancy statistics", failed);
+	test_fixture_teardown(&fix);
+}
+
+/* Application processor which does not drain P2A acknowledgement queue */
+static void test_ack_backpressure(const char *name,
+				  const struct rpmi_shmem_platform_ops *ops)
+{
+	rpmi_uint32_t i, posted = 0, total = 0, queue_slots;
+	struct test_shmem_counters cnt = { 0 };
+	struct test_fixture fix = { 0 };
+	int failed = 1;
+
+	if (test_fixture_setup(&fix, ops, &cnt, 0, 2))
+		goto done;
+
+	/* Usable slots of a queue in spec layout */
+	queue_slots = (TEST_BENCH_SHM_SIZE / 4) / TEST_BENCH_SLOT_SIZE - 3;
+
+	/* Keep posting requests until the context stops consuming them */
+	for (i = 0; i < 4 && !rpmi_context_ack_stall_count(fix.cntx); i++) {
+		if (test_post_requests(fix.xport, fix.msg, queue_slots))
+			goto done;
+		posted += queue_slots;
+		rpmi_context_process_a2p_request(fix.cntx);
+	}
+	if (!rpmi_context_ack_stall_count(fix.cntx))
+		goto done;
+
+	/* Draining acknowledgements lets the context make progress again */
+	for (i = 0; i < 16 && total < posted; i++) {
+		total += test_count_acks(fix.xport, fix.msg);
+		rpmi_context_process_a2p_request(fix.cntx);
+	}
+
+	/* Every posted request must be acknowledged exactly once */
+	total += test_count_acks(fix.xport, fix.msg);
+	if (total == posted && rpmi_transport_is_empty(fix.xport, RPMI_QUEUE_A2P_REQ))
+		failed = 0;
+
+done:
+	test_report(name, failed);
+	test_fixture_teardown(&fix);
+}
+
+int main(int argc, char *argv[])
+{
+	int i, do_bench = 0;
+
+	/* Throughput benchmark takes long so it only runs when asked for */
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--bench"))
+			do_bench = 1;
+	}
+
+	printf("\nExecuting shared memory transport tests :\n");
+	printf("-------------------------------------------------\n");
+
+	test_bench_layout("Spec layout", 0);
+	test_bench_layout("Spec layout (spsc)", LIBRPMI_TRANSPORT_SHMEM_FLAG_SPSC);
+	test_bench_layout("Power-of-two layout (spsc)",
+			  LIBRPMI_TRANSPORT_SHMEM_FLAG_SPSC |
+			  LIBRPMI_TRANSPORT_SHMEM_FLAG_POW2);
+
+	if (do_bench) {
+		test_bench_slot_copy(64);
+		test_bench_slot_copy(128);
+		test_bench_slot_copy(256);
+		test_bench_slot_copy(1024);
+	}
+
+	test_header_endianness("Header byte order (little-endian)", false);
+#ifndef LIBRPMI_LE_ONLY
+	test_header_endianness("Header byte order (big-endian)", true);
+#endif
+
+	test_batch_wrap("Batch wraparound (spec layout)", 0, true);
+	test_batch_wrap("Batch wraparound (power-of-two layout)",
+			LIBRPMI_TRANSPORT_SHMEM_FLAG_POW2, true);
+	test_batch_wrap("Batch wraparound (single message fallback)", 0, false);
+
+	test_peek_commit();
+
+	test_multi_transport();
+	test_dispatch_tables();
+	test_transport_doorbell();
+	test_oversized_request("Oversized request (in-place)",
+			       &rpmi_shmem_simple_ops);
+	test_oversized_request("Oversized request (copy)", &test_shmem_count_ops);
+
+	test_request_budget();
+
+	test_context_run();
+	test_run_backpressure("Run loop after P2A backpressure (in-place)",
+			      &rpmi_shmem_simple_ops);
+	test_run_backpressure("Run loop after P2A backpressure (copy)",
+			      &test_shmem_count_ops);
+
+	test_queue_stats();
+
+	test_pending_events();
+
+	test_coalesce("Posted request coalescing (copy)", &test_shmem_count_ops);
+	test_coalesce("Posted request coalescing (in-place)",
+		      &rpmi_shmem_simple_ops);
+
+	test_priority("High priority groups first (copy)", &test_shmem_count_ops);
+	test_priority("High priority groups first (in-place)",
+		      &rpmi_shmem_simple_ops);
+
+	test_deferred();
+	test_deferred_wrap();
+
+	test_notifications();
+	test_notifications_multi_transport();
+
+	test_ack_backpressure("Acknowledgement backpressure (copy)",
+			      &test_shmem_count_ops);
+	test_ack_backpressure("Acknowledgement backpressure (in-place)",
+			      &rpmi_shmem_simple_ops);
+
+	return test_failure_count() ? 1 : 0;
+}